@@ -29,4 +29,7 @@ void setup() {
 	d.start();
 }
 
-void loop() {}
\ No newline at end of file
+// Wait for the next drawing
+void loop() {
+	d.idle();
+}
\ No newline at end of file
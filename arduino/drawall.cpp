@@ -22,13 +22,12 @@
 // TODO use all variables without Arduino.h defines, like true, false, etc.
 // TODO Make a Parameter object
 // TODO: Interrupt routine with ISR(INT0_vect){...}
-// TODO: make a method to write data on serial, with #if EN_SERIAL test
 
 void Drawall::start() {
 	pinInitialization();
 
 #if EN_SERIAL
-	Serial.begin(SERIAL_BAUDS);
+	serialLink.begin();
 #endif
 
 	if (!SD.begin(PIN_SD_CS)) {
@@ -38,13 +37,28 @@ void Drawall::start() {
 	// Load all parameters from the configuration file
 	loadParameters();
 
-	// TODO add this parameter to the configuration file
-	startupEventConf = START_WITH_DELAY;
-
 	servo.attach(PIN_SERVO);
 	servo.write(PLT_MAX_SERVO_ANGLE);
 
-	isWriting = true; // to make write() works for the first time.
+	// The pen is up: a first move is not a short pen-up move after a line (see move()).
+	isWriting = false;
+	penState = PEN_IDLE;
+	hasPendingPoint = false;
+	windowLength = 0;
+	hasPendingHop = false;
+	savedPenCycles = 0;
+	isStreaming = false;
+	canCheckpoint = false;
+	checkpointNumber = 0;
+	jobOffset = 0;
+	jobScale = 100;
+	offsetX = 0;
+	offsetY = 0;
+	hasDrawn = false;
+
+	// Until the first drawing sets the position (see initPosition()), the pen is at the origin of the drawing.
+	plotterPosX = 0;
+	plotterPosY = 0;
 
 #if EN_STEP_MODES
 	setStepMode();
@@ -52,9 +66,19 @@ void Drawall::start() {
 
 	stepLength = getStepLength();
 
+#if EN_LENGTH_TABLE
+	// Distances between the belts extremities, for both belts, when the pen is on the sheet
+	lengthTable.build(
+			min(sheetPosXConf, spanConf - sheetPosXConf - sheetWidthConf)
+					* 1000L, sheetPosYConf * 1000L,
+			max(sheetPosXConf + sheetWidthConf, spanConf - sheetPosXConf)
+					* 1000L, (sheetPosYConf + sheetHeightConf) * 1000L);
+#endif
+
 	// Get the belts length
-	leftLength = positionToLeftLength(initPosXConf, initPosYConf);
-	rightLength = positionToRightLength(initPosXConf, initPosYConf);
+	leftLength = positionToLeftLength(initPosXConf * 1000L, initPosYConf * 1000L);
+	rightLength = positionToRightLength(initPosXConf * 1000L,
+			initPosYConf * 1000L);
 
 #ifdef I_AM_CODING
 	delayBetweenSteps = getDelay(100);
@@ -62,41 +86,70 @@ void Drawall::start() {
 	delayBetweenSteps = getDelay(maxSpeedConf);
 #endif
 
+#ifdef I_AM_CODING
+	planner.start(getRate(100), getRate(jerkConf), 0, 0);
+#else
+	// Acceleration, converted from mm/s² to a rate increase on each interrupt.
+	planner.start(getRate(maxSpeedConf), getRate(jerkConf),
+			MOTORS_RATE_ONE * (accelerationConf / stepLength)
+					/ ((float) MOTORS_FREQUENCY * MOTORS_FREQUENCY),
+			junctionDeviationConf / 1000.0);
+#endif
+
+	reportedLeftLength = leftLength;
+	reportedRightLength = rightLength;
+	lastReportTime = 0;
+	motors.start(leftLength, rightLength);
+
 #if EN_SERIAL
 	// Send initialization data to computer
-	Serial.println("READY");
+	serialLink.println("READY");
 	delay(100);
 
-	Serial.write(DRAW_START_INSTRUCTIONS);
-	Serial.println(spanConf);
-	Serial.println(sheetPosXConf);
-	Serial.println(sheetPosYConf);
-	Serial.println(sheetWidthConf);
-	Serial.println(sheetHeightConf);
-	Serial.println(leftLength);
-	Serial.println(rightLength);
-	Serial.println(stepLength * 1000);
-	Serial.write(DRAW_END_INSTRUCTIONS);
+	serialLink.write(DRAW_START_INSTRUCTIONS);
+	serialLink.println(spanConf);
+	serialLink.println(sheetPosXConf);
+	serialLink.println(sheetPosYConf);
+	serialLink.println(sheetWidthConf);
+	serialLink.println(sheetHeightConf);
+	serialLink.println(leftLength);
+	serialLink.println(rightLength);
+	serialLink.println(stepLength * 1000);
+	serialLink.write(DRAW_END_INSTRUCTIONS);
 #endif
 
 	power(true);
 
 	switch (startupEventConf) {
 	case START_WITH_DELAY:
-		Serial.write(DRAW_WAITING);
+		serialLink.write(DRAW_WAITING);
+#if EN_SERIAL_FRAMES
+		serialLink.flush();
+#endif
 		delay(initDelayConf);
 		break;
 	case START_WITH_BUTTON:
 		// TODO: Wait until start button is pressed.
 		break;
 	case START_WITH_SERIAL:
-		// TODO: Wait until start signal is raised on the serial port.
+		// The GCode lines are sent by the computer, which waits for DRAW_ACK after each of them, or for the
+		// acknowledgment of each frame with EN_SERIAL_FRAMES.
+		serialLink.write(DRAW_WAITING);
+#if EN_SERIAL_FRAMES
+		serialLink.flush();
+#endif
+		isStreaming = true;
 		break;
 	default:
 		break;
 	}
 
-	draw();
+	if (!isStreaming && SD.exists(JOBS_FILE_NAME)) {
+		drawJobs();
+	} else {
+		draw();
+	}
+	end();
 }
 
 void Drawall::pinInitialization() {
@@ -163,174 +216,850 @@ float Drawall::getDelay(unsigned int speed) {
 	return 1000000 * stepLength / float(speed);
 }
 
-// TODO use a Macro Expansion
-long Drawall::positionToLeftLength(float posX, float posY) {
-	return sqrt(
-			pow(((float) sheetPosXConf + posX) / stepLength, 2)
-					+ pow(
-							((float) sheetPosYConf + sheetHeightConf - posY)
-									/ stepLength, 2));
+unsigned long Drawall::getRate(unsigned int speed) {
+	float delay = getDelay(speed);
+
+	// The motors can not do more than one step by interrupt.
+	if (delay > 1000000.0 / MOTORS_FREQUENCY) {
+		return MOTORS_RATE_ONE * (1000000.0 / MOTORS_FREQUENCY) / delay;
+	} else {
+		return MOTORS_RATE_ONE;
+	}
 }
 
-// TODO use a Macro Expansion
-long Drawall::positionToRightLength(float posX, float posY) {
-	return sqrt(
-			pow(((float) spanConf - (float) sheetPosXConf - posX) / stepLength,
-					2)
-					+ pow(
-							((float) sheetPosYConf + sheetHeightConf - posY)
-									/ stepLength, 2));
+long Drawall::positionToLeftLength(long posX, long posY) {
+	PROFILE_ENTER(PROFILE_KINEMATICS);
+#if EN_LENGTH_TABLE
+	long length = lengthTable.getLength(sheetPosXConf * 1000L + posX,
+			(sheetPosYConf + sheetHeightConf) * 1000L - posY);
+#else
+	long length = beltLength(sheetPosXConf * 1000L + posX,
+			(sheetPosYConf + sheetHeightConf) * 1000L - posY);
+#endif
+	PROFILE_EXIT(PROFILE_KINEMATICS);
+	return length;
+}
+
+long Drawall::positionToRightLength(long posX, long posY) {
+	PROFILE_ENTER(PROFILE_KINEMATICS);
+#if EN_LENGTH_TABLE
+	long length = lengthTable.getLength(
+			(spanConf - sheetPosXConf) * 1000L - posX,
+			(sheetPosYConf + sheetHeightConf) * 1000L - posY);
+#else
+	long length = beltLength((spanConf - sheetPosXConf) * 1000L - posX,
+			(sheetPosYConf + sheetHeightConf) * 1000L - posY);
+#endif
+	PROFILE_EXIT(PROFILE_KINEMATICS);
+	return length;
+}
+
+void Drawall::lengthsToPosition(float left, float right, float *posX,
+		float *posY) {
+	PROFILE_ENTER(PROFILE_KINEMATICS);
+
+	// Belt lengths, in micrometers
+	left *= stepLength * 1000;
+	right *= stepLength * 1000;
+	float span = spanConf * 1000.0;
+
+	// Position according to the left belt extremity
+	float x = (left * left - right * right + span * span) / (2 * span);
+	float y = sqrt(left * left - x * x);
+
+	*posX = x - sheetPosXConf * 1000.0;
+	*posY = (sheetPosYConf + sheetHeightConf) * 1000.0 - y;
+
+	PROFILE_EXIT(PROFILE_KINEMATICS);
 }
 
 void Drawall::power(bool shouldPower) {
+	waitForMotors();
+
 	if (shouldPower) {
 		digitalWrite(PIN_ENABLE_MOTORS, LOW);
 #if EN_SERIAL
-		Serial.write(DRAW_ENABLE_MOTORS);
+		serialLink.write(DRAW_ENABLE_MOTORS);
 #endif
 	} else {
 		digitalWrite(PIN_ENABLE_MOTORS, HIGH);
 #if EN_SERIAL
-		Serial.write(DRAW_DISABLE_MOTORS);
+		serialLink.write(DRAW_DISABLE_MOTORS);
 #endif
 		writingPen(false);
+		waitForMotors();
 	}
 }
 
 void Drawall::writingPen(bool shouldWrite) {
-	if (shouldWrite && !isWriting) {
-		// If pen is not writing and should write
-		delay(PLT_PRE_SERVO_DELAY);
-		servo.write(PLT_MIN_SERVO_ANGLE);
-		// TODO multiply by drawingPenDep
-		delay(PLT_POST_SERVO_DELAY);
+	if (shouldWrite == isWriting) {
+		return;
+	}
 
-#if EN_SERIAL
-		Serial.write(DRAW_WRITING);
-#endif
-		isWriting = true;
-	} else if (!shouldWrite && isWriting) {
-		// If pen is writing and shouldn't
-		delay(PLT_PRE_SERVO_DELAY);
-		servo.write(PLT_MAX_SERVO_ANGLE);
-		// TODO multiply by movingPenDep
-		delay(PLT_POST_SERVO_DELAY);
+	// The servo-motor moves once the previous moves and pen move are over.
+	waitForMotors();
+	PROFILE_ENTER(PROFILE_PEN);
+
+	// The delays are given for a full travel of the servo-motor.
+	int travel = abs(
+			servo.read()
+					- (shouldWrite ? PLT_MIN_SERVO_ANGLE : PLT_MAX_SERVO_ANGLE));
+	penPreDelay = (unsigned long) penPreDelayConf * travel
+			/ (PLT_MAX_SERVO_ANGLE - PLT_MIN_SERVO_ANGLE);
+	penPostDelay = (unsigned long) penPostDelayConf * travel
+			/ (PLT_MAX_SERVO_ANGLE - PLT_MIN_SERVO_ANGLE);
+
+	// The next moves are queued while the pen moves, but wait for it.
+	motors.hold(true);
+	isWriting = shouldWrite;
+	penState = PEN_WAITING;
+	penStartTime = millis();
+	PROFILE_EXIT(PROFILE_PEN);
+
+	// Out of the section, which updatePen() profiles by itself.
+	updatePen();
+}
 
+bool Drawall::updatePen() {
+	if (penState == PEN_IDLE) {
+		return true;
+	}
+
+	PROFILE_ENTER(PROFILE_PEN);
+	unsigned long elapsed = millis() - penStartTime;
+
+	if (penState == PEN_WAITING && elapsed >= penPreDelay) {
+		// TODO use drawingInsert and movingInsert
+		servo.write(isWriting ? PLT_MIN_SERVO_ANGLE : PLT_MAX_SERVO_ANGLE);
 #if EN_SERIAL
-		Serial.write(DRAW_MOVING);
+		serialLink.write(isWriting ? DRAW_WRITING : DRAW_MOVING);
 #endif
-		isWriting = false;
+		penState = PEN_SETTLING;
+
+		// The pen leaves the sheet as soon as the servo-motor moves: the motors can go on.
+		if (!isWriting) {
+			motors.hold(false);
+		}
 	}
+
+	if (penState == PEN_SETTLING
+			&& elapsed >= (unsigned long) penPreDelay + penPostDelay) {
+		motors.hold(false);
+		penState = PEN_IDLE;
+	}
+
+	PROFILE_EXIT(PROFILE_PEN);
+	return penState == PEN_IDLE;
 }
 
-void Drawall::leftStep(bool shouldPull) {
-	if (shouldPull) {
-		leftLength--;
+bool Drawall::reportSteps() {
+	PROFILE_LOOP(!motors.isIdle());
+	updatePen();
+
 #if EN_SERIAL
-		Serial.write(DRAW_PULL_LEFT);
+	unsigned long left = motors.getLeftLength();
+	unsigned long right = motors.getRightLength();
+
+#if EN_SERIAL_FRAMES
+	if (millis() - lastReportTime >= SERIAL_FRAMES_REPORT_PERIOD
+			&& (left != reportedLeftLength || right != reportedRightLength)) {
+		int leftDelta = constrain((long) (left - reportedLeftLength), -32767,
+				32767);
+		int rightDelta = constrain((long) (right - reportedRightLength),
+				-32767, 32767);
+
+		// When the frame is full, the steps are reported in the next snapshot.
+		if (serialLink.addState(leftDelta, rightDelta, isWriting)) {
+			lastReportTime = millis();
+			reportedLeftLength += leftDelta;
+			reportedRightLength += rightDelta;
+		}
+	}
+
+	if (!serialLink.update(motors.isIdle())) {
+		return false;
+	}
+#elif EN_STEP_BYTES
+	while (reportedLeftLength != left && Serial.availableForWrite() > 0) {
+		if (left < reportedLeftLength) {
+			serialLink.write(DRAW_PULL_LEFT);
+			reportedLeftLength--;
+		} else {
+			serialLink.write(DRAW_RELEASE_LEFT);
+			reportedLeftLength++;
+		}
+	}
+
+	while (reportedRightLength != right && Serial.availableForWrite() > 0) {
+		if (right < reportedRightLength) {
+			serialLink.write(DRAW_PULL_RIGHT);
+			reportedRightLength--;
+		} else {
+			serialLink.write(DRAW_RELEASE_RIGHT);
+			reportedRightLength++;
+		}
+	}
+#else
+	if (left != reportedLeftLength || right != reportedRightLength) {
+		if (millis() - lastReportTime < SERIAL_REPORT_PERIOD
+				|| Serial.availableForWrite() < 6) {
+			return false;
+		}
+		lastReportTime = millis();
+
+		int leftDelta = constrain((long) (left - reportedLeftLength), -32767,
+				32767);
+		int rightDelta = constrain((long) (right - reportedRightLength),
+				-32767, 32767);
+
+		serialLink.write(DRAW_STEPS);
+		serialLink.write(leftDelta & 0xFF);
+		serialLink.write(leftDelta >> 8);
+		serialLink.write(rightDelta & 0xFF);
+		serialLink.write(rightDelta >> 8);
+		serialLink.write(isWriting);
+
+		reportedLeftLength += leftDelta;
+		reportedRightLength += rightDelta;
+	}
 #endif
-	} else {
-		leftLength++;
-#if EN_SERIAL
-		Serial.write(DRAW_RELEASE_LEFT);
+
+	return reportedLeftLength == left && reportedRightLength == right;
+#else
+	return true;
 #endif
+}
+
+void Drawall::waitForMotors() {
+	PROFILE_ENTER(PROFILE_WAITING);
+
+	while (!planner.flush() || !motors.isIdle() || penState != PEN_IDLE) {
+		reportSteps();
 	}
 
-	digitalWrite(
-	PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_STEP : PIN_LEFT_MOTOR_STEP,
-			leftLength % 2);
+	while (!reportSteps())
+		;
+
+	PROFILE_EXIT(PROFILE_WAITING);
 }
 
-void Drawall::rightStep(bool shouldPull) {
-	if (shouldPull) {
-		rightLength--;
-#if EN_SERIAL
-		Serial.write(DRAW_PULL_RIGHT);
-#endif
+void Drawall::line(float x, float y) {
+	if (hasPendingHop) {
+		// The pen stays down along the pen-up move.
+		hasPendingHop = false;
+		savedPenCycles++;
+		if (hopX != plotterPosX || hopY != plotterPosY) {
+			line(hopX, hopY);
+		}
+	}
+
+	if (simplifyToleranceConf == 0) {
+		drawLine(x, y);
+		return;
+	}
+
+	if (hasPendingPoint) {
+		if (windowLength < SIMPLIFY_WINDOW_SIZE && isSimplifiable(x, y)) {
+			// The pending point is on the way: keep it only to check the next lines.
+			windowX[windowLength] = pendingX;
+			windowY[windowLength] = pendingY;
+			windowLength++;
+		} else {
+			drawLine(pendingX, pendingY);
+			windowLength = 0;
+		}
+	}
+
+	pendingX = x;
+	pendingY = y;
+	hasPendingPoint = true;
+}
+
+void Drawall::arc(float x, float y, float i, float j, bool isClockwise) {
+	float startX;
+	float startY;
+	getLastPoint(&startX, &startY);
+
+	float centerX = startX + i;
+	float centerY = startY + j;
+	float radius = hypot(i, j);
+	float startAngle = atan2(startY - centerY, startX - centerX);
+
+	// Angle from the start to the end, in the direction of the arc: an arc ending at its start is a circle.
+	float sweep = atan2(y - centerY, x - centerX) - startAngle;
+	if (isClockwise && sweep >= 0) {
+		sweep -= 2 * M_PI;
+	} else if (!isClockwise && sweep <= 0) {
+		sweep += 2 * M_PI;
+	}
+
+	// The distance between a chord and the arc is r × (1 - cos(α / 2)), for a chord of angle α.
+	float radiusOnSheet = drawingScale * 1000 * radius;
+	float tolerance = max(arcToleranceConf, 1);
+	int nbChords = 1;
+	if (radiusOnSheet > tolerance) {
+		nbChords = ceil(fabs(sweep) / (2 * acos(1 - tolerance / radiusOnSheet)));
+	}
+
+	for (int k = 1; k < nbChords; k++) {
+		float angle = startAngle + sweep * k / nbChords;
+		line(centerX + radius * cos(angle), centerY + radius * sin(angle));
+	}
+	line(x, y);
+}
+
+void Drawall::getLastPoint(float *x, float *y) {
+	if (hasPendingPoint) {
+		*x = pendingX;
+		*y = pendingY;
+	} else if (hasPendingHop) {
+		*x = hopX;
+		*y = hopY;
 	} else {
-		rightLength++;
-#if EN_SERIAL
-		Serial.write(DRAW_RELEASE_RIGHT);
-#endif
+		*x = plotterPosX;
+		*y = plotterPosY;
+	}
+}
+
+void Drawall::flushLine() {
+	if (hasPendingPoint) {
+		hasPendingPoint = false;
+		windowLength = 0;
+		drawLine(pendingX, pendingY);
 	}
 
-	digitalWrite(
-	PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_STEP : PIN_RIGHT_MOTOR_STEP,
-			rightLength % 2);
+	if (hasPendingHop) {
+		hasPendingHop = false;
+		writingPen(false);
+		segment(hopX, hopY, false);
+		checkpoint();
+	}
 }
 
-void Drawall::line(float x, float y) {
+bool Drawall::isSimplifiable(float x, float y) {
+	// Line from the current point, in micrometers on the sheet
+	float unit = drawingScale * 1000;
+	float dx = (x - plotterPosX) * unit;
+	float dy = (y - plotterPosY) * unit;
+	float length2 = dx * dx + dy * dy;
+	float tolerance2 = (float) simplifyToleranceConf * simplifyToleranceConf;
+
+	for (byte i = 0; i <= windowLength; i++) {
+		float px = ((i < windowLength ? windowX[i] : pendingX) - plotterPosX) * unit;
+		float py = ((i < windowLength ? windowY[i] : pendingY) - plotterPosY) * unit;
+
+		// Distance to the closest point of the line
+		float t = length2 > 0 ? (px * dx + py * dy) / length2 : 0;
+		t = constrain(t, 0, 1);
+		px -= t * dx;
+		py -= t * dy;
+
+		if (px * px + py * py > tolerance2) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Drawall::drawLine(float x, float y) {
 	writingPen(true);
-	int longmax = 5;
 
-	float longX = abs(x - plotterPosX);
-	float longY = abs(y - plotterPosY);
+	unsigned long leftTargetLength;
+	unsigned long rightTargetLength;
 
-	float miniX;
-	float miniY;
-	int boucle;
+	float deviation = getDeviation(x, y, &leftTargetLength, &rightTargetLength);
 
-	if (longX > longmax || longY > longmax) {
-		boucle = ceil((longX > longY ? longX : longY) / longmax);
-		miniX = (x - plotterPosX) / boucle;
-		miniY = (y - plotterPosY) / boucle;
+	// The deviation of a segment is proportional to its squared length,
+	// so this is the number of segments to keep it under the tolerance.
+	// A line without deviation is still one segment.
+	int nbSegments = ceil(sqrt(deviation / max(maxDeviationConf, 1)));
+	if (nbSegments < 1) {
+		nbSegments = 1;
+	}
 
-		for (int i = 0; i < boucle; i++) {
-			segment(plotterPosX + miniX, plotterPosY + miniY, true);
-		}
+	float miniX = (x - plotterPosX) / nbSegments;
+	float miniY = (y - plotterPosY) / nbSegments;
+
+	for (int i = 1; i < nbSegments; i++) {
+		segment(plotterPosX + miniX, plotterPosY + miniY, true);
 	}
-	segment(x, y, true);
+
+	// The end lengths are already known from the deviation.
+	segment(x, y, leftTargetLength, rightTargetLength);
+}
+
+float Drawall::getDeviation(float x, float y, unsigned long *leftTargetLength,
+		unsigned long *rightTargetLength) {
+	float midX;
+	float midY;
+
+	// Position on the sheet, in micrometers
+	long posX = (drawingScale * x + offsetX) * 1000;
+	long posY = (drawingScale * y + offsetY) * 1000;
+
+	*leftTargetLength = positionToLeftLength(posX, posY);
+	*rightTargetLength = positionToRightLength(posX, posY);
+
+	// The motors move the belts linearly, so in the middle of the segment,
+	// the belts lengths are the average of their initial and final lengths.
+	lengthsToPosition((leftLength + *leftTargetLength) / 2.0,
+			(rightLength + *rightTargetLength) / 2.0, &midX, &midY);
+
+	midX -= (drawingScale * (plotterPosX + x) + 2 * offsetX) * 500;
+	midY -= (drawingScale * (plotterPosY + y) + 2 * offsetY) * 500;
+
+	return sqrt(midX * midX + midY * midY);
 }
 
 void Drawall::move(float x, float y) {
+	// The destination of a pending pen-up move is only a way point for this one.
+	hasPendingHop = false;
+	flushLine();
+
+	// A short move after a line is kept until the next command, which tells if the pen must be lifted.
+	if (isWriting
+			&& drawingScale * 1000 * hypot(x - plotterPosX, y - plotterPosY)
+					<= liftThresholdConf) {
+		hasPendingHop = true;
+		hopX = x;
+		hopY = y;
+		return;
+	}
+
+	bool isLifting = isWriting;
 	writingPen(false);
 	segment(x, y, false);
+
+	if (isLifting) {
+		checkpoint();
+	}
+}
+
+void Drawall::openDrawing() {
+	readIndex = 0;
+	readLength = 0;
+
+	if (isStreaming) {
+		isStreamEnded = false;
+		return;
+	}
+
+	file = SD.open(drawingNameConf);
+
+	if (!file) {
+		error(ERR_FILE_NOT_FOUND);
+	}
+}
+
+bool Drawall::isReadable() {
+	if (isStreaming) {
+		return !isStreamEnded;
+	}
+
+	return readIndex < readLength || file.available();
+}
+
+char Drawall::readChar() {
+	if (isStreaming) {
+		int c;
+		while ((c = serialLink.read()) < 0) {
+			reportSteps();
+		}
+		return c;
+	}
+
+	if (readIndex == readLength) {
+		int length = file.read(readBuffer, READ_BUFFER_SIZE);
+		if (length <= 0) {
+			return '\n';
+		}
+		readLength = length;
+		readIndex = 0;
+	}
+
+	return readBuffer[readIndex++];
+}
+
+bool Drawall::isBinaryDrawing() {
+	byte i;
+
+	for (i = 0; i < DWB_MAGIC_LENGTH; i++) {
+		if (readChar() != DWB_MAGIC[i]) {
+			// The magic is in the first chunk, so the file is still fully buffered.
+			readIndex = 0;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+long Drawall::readInteger(byte size) {
+	unsigned long value = 0;
+	byte i;
+
+	for (i = 0; i < size; i++) {
+		value |= (unsigned long) (byte) readChar() << (8 * i);
+	}
+
+	// Sign extension of the 2 bytes integers
+	if (size == 2) {
+		return (int16_t) value;
+	}
+	return value;
+}
+
+void Drawall::processBinaryRecords() {
+	// The pen is up at the beginning, as at a checkpoint.
+	bool isPenDown = false;
+	byte opcode;
+
+	while (isReadable()) {
+		PROFILE_ENTER(PROFILE_PARSING);
+		opcode = readChar();
+
+		switch (opcode) {
+		case DWB_END:
+			PROFILE_EXIT(PROFILE_PARSING);
+			return;
+		case DWB_PEN_UP:
+			isPenDown = false;
+			break;
+		case DWB_PEN_DOWN:
+			isPenDown = true;
+			break;
+		case DWB_DELTA:
+		case DWB_POINT:
+			if (opcode == DWB_DELTA) {
+				recordPosX += readInteger(2);
+				recordPosY += readInteger(2);
+			} else {
+				recordPosX = readInteger(4);
+				recordPosY = readInteger(4);
+			}
+
+			if (isPenDown) {
+				line(recordPosX * 0.001, recordPosY * 0.001);
+			} else {
+				move(recordPosX * 0.001, recordPosY * 0.001);
+			}
+			break;
+		case DWB_WAIT:
+			flushLine();
+			waitForMotors();
+			delay(readInteger(2) & 0xFFFF); // drink some coffee
+			serialLink.write(DRAW_WAITING);
+			break;
+		default:
+			warning(WARN_UNKNOWN_GCODE_FUNCTION);
+			break;
+		}
+		PROFILE_EXIT(PROFILE_PARSING);
+	}
+}
+
+void Drawall::initCheckpoints() {
+	Checkpoint last;
+	uint8_t zeros[32];
+	unsigned int i;
+
+	recordPosX = 0;
+	recordPosY = 0;
+	lastCheckpointTime = millis();
+	canCheckpoint = !isStreaming && checkpointPeriodConf > 0;
+
+	if (!canCheckpoint) {
+		return;
+	}
+
+	if (loadCheckpoint(&last)) {
+		file.seek(last.offset);
+		readIndex = 0;
+		readLength = 0;
+		recordPosX = last.recordPosX;
+		recordPosY = last.recordPosY;
+		checkpointNumber = last.number;
+
+#if EN_SERIAL
+		serialLink.write(DRAW_START_MESSAGE);
+		serialLink.print("resumeOffset=");
+		serialLink.println(last.offset);
+		serialLink.write(DRAW_END_MESSAGE);
+#endif
+
+		// The plotter starts from its initial position, as for a new drawing.
+		initPosition();
+		move(last.posX, last.posY);
+		return;
+	}
+
+	// The first drawing since the start: the file is allocated at once, so the checkpoints never change its
+	// size. The next drawings of a job list go on with the numbers of the previous ones.
+	if (checkpointNumber == 0) {
+		SD.remove(CHECKPOINT_FILE_NAME);
+		File checkpointFile = SD.open(CHECKPOINT_FILE_NAME, O_RDWR | O_CREAT);
+		if (!checkpointFile) {
+			canCheckpoint = false;
+			return;
+		}
+
+		memset(zeros, 0, sizeof(zeros));
+		for (i = 0; i < CHECKPOINT_NB_SLOTS * CHECKPOINT_SLOT_SIZE; i += sizeof(zeros)) {
+			checkpointFile.write(zeros, sizeof(zeros));
+		}
+		checkpointFile.close();
+	}
+
+	// An interruption before the first pen lift resumes the drawing from its beginning.
+	checkpoint(true);
+}
+
+void Drawall::checkpoint(bool isForced) {
+	Checkpoint checkpoint;
+
+	if (!canCheckpoint
+			|| (!isForced
+					&& millis() - lastCheckpointTime
+							< checkpointPeriodConf * 1000UL)) {
+		return;
+	}
+	lastCheckpointTime = millis();
+
+	// The padding bytes are part of the CRC.
+	memset(&checkpoint, 0, sizeof(checkpoint));
+	checkpoint.number = ++checkpointNumber;
+	strcpy(checkpoint.drawingName, drawingNameConf);
+	checkpoint.fileSize = file.size();
+	checkpoint.jobOffset = jobOffset;
+
+	// The move is the last line read, but the rest of the buffer is not read yet.
+	checkpoint.offset = file.position() - (readLength - readIndex);
+	checkpoint.posX = plotterPosX;
+	checkpoint.posY = plotterPosY;
+	checkpoint.recordPosX = recordPosX;
+	checkpoint.recordPosY = recordPosY;
+	setCheckpointLengths(&checkpoint);
+	checkpoint.crc = getCheckpointCrc(&checkpoint);
+
+	// A lost checkpoint does not stop the drawing: the previous one is still valid. Not FILE_WRITE, whose
+	// O_APPEND would write the record at the end of the file, whatever the seek.
+	File checkpointFile = SD.open(CHECKPOINT_FILE_NAME, O_RDWR | O_CREAT);
+	if (checkpointFile) {
+		checkpointFile.seek(
+				(checkpointNumber % CHECKPOINT_NB_SLOTS) * CHECKPOINT_SLOT_SIZE);
+		checkpointFile.write((const uint8_t *) &checkpoint, sizeof(checkpoint));
+		checkpointFile.close();
+	}
+}
+
+bool Drawall::readCheckpoint(Checkpoint *checkpoint) {
+	Checkpoint slot;
+	bool isFound = false;
+	byte i;
+
+	File checkpointFile = SD.open(CHECKPOINT_FILE_NAME, FILE_READ);
+	if (!checkpointFile) {
+		return false;
+	}
+
+	// The empty and torn records do not match their CRC.
+	for (i = 0; i < CHECKPOINT_NB_SLOTS; i++) {
+		checkpointFile.seek((unsigned long) i * CHECKPOINT_SLOT_SIZE);
+		if (checkpointFile.read(&slot, sizeof(slot)) == sizeof(slot)
+				&& slot.crc == getCheckpointCrc(&slot)
+				&& (!isFound || slot.number > checkpoint->number)) {
+			*checkpoint = slot;
+			isFound = true;
+		}
+	}
+	checkpointFile.close();
+
+	return isFound;
+}
+
+bool Drawall::loadCheckpoint(Checkpoint *checkpoint) {
+	Checkpoint current;
+
+	if (!readCheckpoint(checkpoint) || checkpoint->jobOffset != jobOffset
+			|| strcmp(checkpoint->drawingName, drawingNameConf)
+			|| checkpoint->fileSize != file.size()) {
+		return false;
+	}
+
+	// The belt lengths change with the plotter geometry, and the drawing position and scale.
+	current = *checkpoint;
+	setCheckpointLengths(&current);
+	return current.leftLength == checkpoint->leftLength
+			&& current.rightLength == checkpoint->rightLength;
+}
+
+void Drawall::setCheckpointLengths(Checkpoint *checkpoint) {
+	long posX = (drawingScale * checkpoint->posX + offsetX) * 1000;
+	long posY = (drawingScale * checkpoint->posY + offsetY) * 1000;
+
+	checkpoint->leftLength = positionToLeftLength(posX, posY);
+	checkpoint->rightLength = positionToRightLength(posX, posY);
+}
+
+uint16_t Drawall::getCheckpointCrc(Checkpoint *checkpoint) {
+	uint16_t crc = 0xFFFF;
+	const uint8_t *bytes = (const uint8_t *) checkpoint;
+
+	while (bytes < (const uint8_t *) &checkpoint->crc) {
+		crc = frameCrc(crc, *bytes++);
+	}
+	return crc;
+}
+
+long Drawall::readNumber(char *car) {
+	long value = 0;
+	bool isNegative = false;
+	bool isDecimal = false;
+	byte decimals = 3; // remaining decimals to read
+
+	char c = readChar();
+	if (c == '-') {
+		isNegative = true;
+		c = readChar();
+	} else if (c == '+') {
+		c = readChar();
+	}
+
+	for (;; c = readChar()) {
+		if (c >= '0' && c <= '9') {
+			if (!isDecimal) {
+				value = value * 10 + c - '0';
+			} else if (decimals > 0) {
+				value = value * 10 + c - '0';
+				decimals--;
+			} // the next decimals are ignored
+		} else if (c == '.' && !isDecimal) {
+			isDecimal = true;
+		} else {
+			break;
+		}
+	}
+
+	for (; decimals > 0; decimals--) {
+		value *= 10;
+	}
+
+	*car = c;
+	return isNegative ? -value : value;
 }
 
 void Drawall::processSDLine() {
-#define PARAM_MAX_LENGTH 5
 #define FUNC_NAME_MAX_LENGTH 3
 
-	byte i, j;
+	byte i;
 	char functionName[FUNC_NAME_MAX_LENGTH + 1];
 	char car;
-	char parameter[PARAM_MAX_LENGTH + 1];
-	unsigned int parameters[2];
+	char letter;
+	long value;
+
+	// Parameters, in thousandths of drawing unit (or of second for P)
+	long paramX = 0;
+	long paramY = 0;
+	long paramZ = 0;
+	long paramP = 0;
+	long paramI = 0;
+	long paramJ = 0;
+	bool hasX = false;
+	bool hasY = false;
+	bool hasZ = false;
 
 	// Get function name
-	car = file.read();
-	for (i = 0; car != ' ' && car != '\n' && i < FUNC_NAME_MAX_LENGTH + 1;
-			i++) {
-		functionName[i] = car;
-		car = file.read();
+	i = 0;
+	car = readChar();
+	while (car != ' ' && car != '\r' && car != '\n') {
+		if (i < FUNC_NAME_MAX_LENGTH) {
+			functionName[i++] = car;
+		}
+		car = readChar();
 	}
 	functionName[i] = '\0';
 
+	// Ignore empty and commented lines
+	if (functionName[0] == '\0' || functionName[0] == '#'
+			|| functionName[0] == ';' || functionName[0] == '(') {
+		while (car != '\n') {
+			car = readChar();
+		}
+		return;
+	}
+
 	// Get parameters
-	// The first char has been already read.
-	for (i = 0; car != '\n'; i++) {
-		car = file.read(); // first parameter char (X, Y or Z)
-		for (j = 0; car != ' ' && car != '\n' && j < PARAM_MAX_LENGTH + 1;
-				j++) {
-			if (j == 0) {
-				car = file.read(); // pass first parameter char
-			}
-			parameter[j] = car;
-			car = file.read();
+	// The char following the function name has been already read.
+	while (car != '\n') {
+		letter = readChar(); // parameter letter (X, Y, Z, P, I or J)
+		if (letter == ' ' || letter == '\r' || letter == '\n') {
+			car = letter;
+			continue;
+		}
+
+		value = readNumber(&car);
+
+		switch (letter) {
+		case 'X':
+			paramX = value;
+			hasX = true;
+			break;
+		case 'Y':
+			paramY = value;
+			hasY = true;
+			break;
+		case 'Z':
+			paramZ = value;
+			hasZ = true;
+			break;
+		case 'P':
+			paramP = value;
+			break;
+		case 'I':
+			paramI = value;
+			break;
+		case 'J':
+			paramJ = value;
+			break;
+		default:
+			warning(WARN_UNKNOWN_GCODE_PARAMETER);
+			break;
 		}
-		parameter[j] = '\0';
-		parameters[i] = atoi(parameter);
+	}
+
+	// Missing coordinates keep their current value
+	float x;
+	float y;
+	getLastPoint(&x, &y);
+	if (hasX) {
+		x = 5000 + paramX * 0.001;
+	}
+	if (hasY) {
+		y = paramY * 0.001;
 	}
 
 	// Process the GCode function
 	if (!strcmp(functionName, "G00")) {
-		move(5000 + parameters[0], parameters[1]); // move
+		move(x, y); // move
 	} else if (!strcmp(functionName, "G01")) {
-		line(5000 + parameters[0], parameters[1]); // draw
+		if (hasZ && paramZ > 0) {
+			move(x, y); // the pen is raised
+		} else {
+			line(x, y); // draw
+		}
+	} else if (!strcmp(functionName, "G02") || !strcmp(functionName, "G03")) {
+		// Arc, clockwise with G02, around the center at [I ; J] from the current point
+		arc(x, y, paramI * 0.001, paramJ * 0.001, functionName[2] == '2');
 	} else if (!strcmp(functionName, "G04")) {
-		delay(1000 * parameters[0]); // drink some coffee
-		Serial.write(DRAW_WAITING);
-	} else if (!strcmp(functionName, "G21") || !strcmp(functionName, "M30")) {
+		flushLine();
+		waitForMotors();
+		delay(paramP > 0 ? paramP : paramX); // drink some coffee
+		serialLink.write(DRAW_WAITING);
+	} else if (!strcmp(functionName, "M02") || !strcmp(functionName, "M30")) {
+		// End of the program, which ends a streamed drawing
+		isStreamEnded = true;
+	} else if (!strcmp(functionName, "G21")) {
 		// Knows but useless GCode functions
 	} else {
 		warning(WARN_UNKNOWN_GCODE_FUNCTION); // raise warning
@@ -338,133 +1067,119 @@ void Drawall::processSDLine() {
 }
 
 void Drawall::segment(float x, float y, bool isWriting) {
-	unsigned long leftTargetLength = positionToLeftLength(
-			drawingScale * x, drawingScale * y);
-	unsigned long rightTargetLength = positionToRightLength(
-			drawingScale * x, drawingScale * y);
+	// Position on the sheet, in micrometers
+	long posX = (drawingScale * x + offsetX) * 1000;
+	long posY = (drawingScale * y + offsetY) * 1000;
+
+	segment(x, y, positionToLeftLength(posX, posY),
+			positionToRightLength(posX, posY));
+}
+
+void Drawall::segment(float x, float y, unsigned long leftTargetLength,
+		unsigned long rightTargetLength) {
+	PROFILE_ENTER(PROFILE_SEGMENT);
+	updatePen();
 
 	// get the number of steps to do
 	long nbPasG = leftTargetLength - leftLength;
 	long nbPasD = rightTargetLength - rightLength;
 
-	bool pullLeft;
-	bool pullRight;
-
-	float delaiG;
-	float delaiD;
-
-	unsigned long dernierTempsG;
-	unsigned long dernierTempsD;
+	Motors::Block block;
 
 	// get the direction
-	pullLeft = nbPasG < 0;
-	pullRight = nbPasD < 0;
+	block.pullLeft = nbPasG < 0;
+	block.pullRight = nbPasD < 0;
 
 	// Since we have the direction, we can leave the sign
-	nbPasG = abs(nbPasG);
-	nbPasD = abs(nbPasD);
-
-	if (nbPasG > nbPasD) {
-		delaiG = delayBetweenSteps;
-		delaiD = delayBetweenSteps * ((float) nbPasG / (float) nbPasD);
-	} else {
-		delaiD = delayBetweenSteps;
-		delaiG = delayBetweenSteps * ((float) nbPasD / (float) nbPasG);
-	}
+	block.leftSteps = abs(nbPasG);
+	block.rightSteps = abs(nbPasD);
 
-	dernierTempsG = micros();
-	dernierTempsD = micros();
+	block.stepCount = max(block.leftSteps, block.rightSteps);
 
-	// TODO digitalWrite() should be called only when the direction is changing
+	if (block.stepCount > 0) {
+		PROFILE_QUEUED_SEGMENT(drawingScale * plotterPosX + offsetX,
+				drawingScale * plotterPosY + offsetY, drawingScale * x + offsetX,
+				drawingScale * y + offsetY, leftTargetLength, rightTargetLength);
 
-	if (pullLeft) {
-		digitalWrite(
-		PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_DIR : PIN_LEFT_MOTOR_DIR,
-		PLT_LEFT_DIRECTION);
-	} else {
-		digitalWrite(
-		PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_DIR : PIN_LEFT_MOTOR_DIR,
-				!PLT_LEFT_DIRECTION);
-	}
-
-	if (pullRight) {
-		digitalWrite(
-		PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_DIR : PIN_RIGHT_MOTOR_DIR,
-		PLT_RIGHT_DIRECTION);
-	} else {
-		digitalWrite(
-		PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_DIR : PIN_RIGHT_MOTOR_DIR,
-				!PLT_RIGHT_DIRECTION);
-	}
-
-	while (nbPasG > 0 || nbPasD > 0) {
-		// if delay is reached and there are steps to do
-		if ((nbPasG > 0) && (micros() - dernierTempsG >= delaiG)) {
-			dernierTempsG = micros(); // save current time
-			leftStep(pullLeft); // do the step
-			nbPasG--; // decrement the remaining steps
-		}
-
-		if ((nbPasD > 0) && (micros() - dernierTempsD >= delaiD)) {
-			dernierTempsD = micros();
-			rightStep(pullRight);
-			nbPasD--;
+		PROFILE_ENTER(PROFILE_WAITING);
+		while (!planner.push(block, drawingScale * (x - plotterPosX),
+				drawingScale * (y - plotterPosY))) {
+			reportSteps();
 		}
+		PROFILE_EXIT(PROFILE_WAITING);
 	}
 
+	leftLength = leftTargetLength;
+	rightLength = rightTargetLength;
+
 	plotterPosX = x;
 	plotterPosY = y;
+
+	PROFILE_EXIT(PROFILE_SEGMENT);
 }
 
 void Drawall::error(SerialData errorNumber) {
 #if EN_SERIAL
-	Serial.print((byte) errorNumber);
+	serialLink.print((byte) errorNumber);
 #endif
 	// TODO ring buzzer
 	delay(1000);
 	writingPen(false);
+	waitForMotors();
 	while (true)
 		;
 }
 
 void Drawall::warning(SerialData warningNumber) {
 #if EN_SERIAL
-	Serial.print((byte) warningNumber);
+	serialLink.print((byte) warningNumber);
 #endif
 	// TODO ring buzzer
 }
 
 void Drawall::initScale(DrawingSize size) {
-	if (drawingWidth / drawingHeight > sheetWidthConf / sheetHeightConf) {
+	// Cross-multiplied: the ratios of the integer bounds would be rounded down.
+	if ((long) drawingWidth * sheetHeightConf > (long) drawingHeight * sheetWidthConf) {
 		drawingScale = (float) sheetWidthConf / drawingWidth;
 	} else {
 		drawingScale = (float) sheetHeightConf / drawingHeight;
 	}
+	drawingScale *= jobScale / 100.0;
 }
 
 // TODO: do not use CardinalPoint
 void Drawall::initOffset(CardinalPoint position) {
 }
 
+void Drawall::initPosition() {
+	float posX;
+	float posY;
+
+	// The pen is where the previous drawing has left it, or at its initial position.
+	lengthsToPosition(leftLength, rightLength, &posX, &posY);
+	plotterPosX = (posX / 1000 - offsetX) / drawingScale;
+	plotterPosY = (posY / 1000 - offsetY) / drawingScale;
+}
+
 // TODO: do not use CardinalPoint
 void Drawall::drawingArea(DrawingSize size, CardinalPoint position) {
-	file = SD.open(drawingNameConf);
-
-	if (!file) {
-		error(ERR_FILE_NOT_FOUND);
-	}
+	openDrawing();
 
 	// TODO make this better
 	drawingWidth = 25000; // processVar();
 	drawingHeight = 25000; // processVar();
 	initScale(size);
 	initOffset(position);
+	if (hasDrawn) {
+		initPosition();
+	}
 
 	move(0, 0);
 	line(drawingWidth, 0);
 	line(drawingWidth, drawingHeight);
 	line(0, drawingHeight);
 	line(0, 0);
+	flushLine();
 
 	offsetX = 0;
 	offsetY = 0;
@@ -475,52 +1190,230 @@ void Drawall::drawingArea(DrawingSize size, CardinalPoint position) {
 
 // TODO: do not use CardinalPoint
 void Drawall::draw(DrawingSize size, CardinalPoint position) {
-	file = SD.open(drawingNameConf);
+	openDrawing();
 
-	if (!file) {
-		error(ERR_FILE_NOT_FOUND);
-	}
+	if (!isStreaming && isBinaryDrawing()) {
+		// Header bounds, rounded up to the next drawing unit
+		drawingWidth = (readInteger(4) + 999) / 1000;
+		drawingHeight = (readInteger(4) + 999) / 1000;
 
-	// TODO make this better
-	drawingWidth = 25000; // processVar();
-	drawingHeight = 25000; // processVar();
+		initScale(size);
+		initOffset(position);
+		if (hasDrawn) {
+			initPosition();
+		}
+		initCheckpoints();
+		processBinaryRecords();
+	} else {
+		// TODO make this better
+		drawingWidth = 25000; // processVar();
+		drawingHeight = 25000; // processVar();
+
+		initScale(size);
+		initOffset(position);
+		if (hasDrawn) {
+			initPosition();
+		}
+		initCheckpoints();
 
-	initScale(size);
-	initOffset(position);
+		// process line until we can read the file
+		while (isReadable()) {
+			PROFILE_ENTER(PROFILE_PARSING);
+			processSDLine();
+			PROFILE_EXIT(PROFILE_PARSING);
+
+#if !EN_SERIAL_FRAMES
+			if (isStreaming) {
+				serialLink.write(DRAW_ACK);
+			}
+#endif
+		}
+	}
 
-	// process line until we can read the file
-	while (file.available()) {
-		processSDLine();
+	flushLine();
+
+	// Once drawn, an interrupted job list goes on with the next drawing.
+	if (canCheckpoint) {
+		writingPen(false);
+		checkpoint(true);
+		canCheckpoint = false;
 	}
 
 	offsetX = 0;
 	offsetY = 0;
 	drawingHeight = sheetHeightConf; // do not subtract the picture height
+	hasDrawn = true;
+
+	if (!isStreaming) {
+		file.close();
+	}
 
-	file.close();
 #if EN_SERIAL
-	Serial.print(DRAW_END_DRAWING);
+	serialLink.print(DRAW_END_DRAWING);
 #endif
-	end();
+}
+
+void Drawall::drawJobs() {
+	Checkpoint checkpoint;
+	unsigned int pause;
+
+	nextJobOffset = 0;
+
+	// An interrupted job list goes on with the drawing of the last checkpoint, which resumes it.
+	if (checkpointPeriodConf > 0 && readCheckpoint(&checkpoint)) {
+		nextJobOffset = checkpoint.jobOffset;
+		if (loadJob(&pause)
+				&& !strcmp(drawingNameConf, checkpoint.drawingName)) {
+			nextJobOffset = jobOffset; // read it again below
+		} else {
+			nextJobOffset = 0; // the job list has changed
+		}
+	}
+
+	while (loadJob(&pause)) {
+		if (pause > 0) {
+			writingPen(false);
+			waitForMotors();
+#if EN_SERIAL
+			serialLink.write(DRAW_CHANGE_TOOL);
+#endif
+			delay(pause * 1000UL);
+		}
+
+		// The pen goes straight from the end of the previous drawing to the beginning of this one.
+		draw();
+	}
+}
+
+bool Drawall::loadJob(unsigned int *pause) {
+#define JOB_MAX_LENGTH 32
+
+	char buffer[JOB_MAX_LENGTH + 1];
+	char *field;
+	byte i;
+	int c;
+
+	File jobsFile = SD.open(JOBS_FILE_NAME, FILE_READ);
+	if (!jobsFile) {
+		return false;
+	}
+	jobsFile.seek(nextJobOffset);
+
+	while (jobsFile.available() > 0) {
+		jobOffset = jobsFile.position();
+
+		// Store the full line in buffer
+		i = 0;
+		while ((c = jobsFile.read()) >= 0 && c != '\n') {
+			if (i == JOB_MAX_LENGTH) {
+				jobsFile.close();
+				error(ERR_TOO_LONG_CONFIG_LINE);
+			}
+			if (c != '\r') {
+				buffer[i++] = c;
+			}
+		}
+		buffer[i] = '\0';
+
+		// Ignore empty or commented lines
+		field = strtok(buffer, " ");
+		if (field == NULL || field[0] == '#') {
+			continue;
+		}
+
+		if (strlen(field) >= sizeof(drawingNameConf)) {
+			jobsFile.close();
+			error(ERR_WRONG_CONFIG_LINE);
+		}
+
+		// The missing fields keep their default value. A wrong one skips the job, instead of drawing it out
+		// of the sheet.
+		if (!readJobField(&offsetX, 0, 0) || !readJobField(&offsetY, 0, 0)
+				|| !readJobField(&jobScale, 100, 1)
+				|| !readJobField(pause, 0, 0)) {
+			warning(WARN_WRONG_JOB_LINE);
+			continue;
+		}
+		strcpy(drawingNameConf, field);
+
+		nextJobOffset = jobsFile.position();
+		jobsFile.close();
+		return true;
+	}
+
+	jobsFile.close();
+	return false;
+}
+
+bool Drawall::readJobField(unsigned int *value, unsigned int defaultValue,
+		unsigned int minValue) {
+	char *field = strtok(NULL, " ");
+	char *end;
+	long number;
+
+	if (field == NULL) {
+		*value = defaultValue;
+		return true;
+	}
+
+	number = strtol(field, &end, 10);
+	if (*end != '\0' || number < (long) minValue
+			|| number > (long) (unsigned int) -1) {
+		return false;
+	}
+	*value = number;
+	return true;
+}
+
+void Drawall::idle() {
+	reportSteps();
+
+	// A drawing sent by the computer starts as soon as it is received, whatever the startup event: after a
+	// streamed drawing, a drawing of the card or a job list.
+	if (serialLink.available()) {
+		isStreaming = true;
+		power(true);
+		draw();
+		end();
+	}
 }
 
 void Drawall::end() {
+	// The end position is on the sheet, in millimeters: it is reached out of the drawing scale.
+	flushLine();
+	drawingScale = 1;
+	initPosition();
 	move(endPosXConf, endPosYConf);
+	flushLine();
+
+	// The last lines have been drawn before lifting the pen: the drawing can not be resumed anymore.
+	if (!isStreaming && checkpointPeriodConf > 0) {
+		SD.remove(CHECKPOINT_FILE_NAME);
+	}
 	// TODO ring buzzer
+
+#if EN_SERIAL
+	serialLink.write(DRAW_START_MESSAGE);
+	serialLink.print("savedPenCycles=");
+	serialLink.println(savedPenCycles);
+#if EN_PROFILING
+	profileReport();
+#endif
+	serialLink.write(DRAW_END_MESSAGE);
+#endif
+
 	power(false);
-	while (true)
-		;
 }
 
 void Drawall::message(char* message) {
-	Serial.write(DRAW_START_MESSAGE);
-	Serial.println(message);
-	Serial.write(DRAW_END_MESSAGE);
+	serialLink.write(DRAW_START_MESSAGE);
+	serialLink.println(message);
+	serialLink.write(DRAW_END_MESSAGE);
 }
 
 void Drawall::loadParameters() {
 #define LINE_MAX_LENGTH 32
-#define NB_PARAMETERS 22
+#define NB_PARAMETERS 32
 
 	char buffer[LINE_MAX_LENGTH + 1];
 	char *key;
@@ -568,9 +1461,9 @@ void Drawall::loadParameters() {
 		key[i] = '\0';
 		value = &buffer[i + 1];
 
-		Serial.print(key);
-		Serial.print("=");
-		Serial.println(value);
+		serialLink.print(key);
+		serialLink.print("=");
+		serialLink.println(value);
 
 		// TODO use constants for the parameters names
 
@@ -584,6 +1477,8 @@ void Drawall::loadParameters() {
 			drawingPosXConf = atoi(value);
 		} else if (!strcmp(key, "drawingPosY")) {
 			drawingPosYConf = atoi(value);
+		} else if (!strcmp(key, "checkpointPeriod")) {
+			checkpointPeriodConf = atoi(value);
 		} else if (!strcmp(key, "span")) {
 			spanConf = atoi(value);
 		} else if (!strcmp(key, "startupEvent")) {
@@ -592,6 +1487,20 @@ void Drawall::loadParameters() {
 			initDelayConf = atoi(value);
 		} else if (!strcmp(key, "maxSpeed")) {
 			maxSpeedConf = atoi(value);
+		} else if (!strcmp(key, "acceleration")) {
+			accelerationConf = atoi(value);
+		} else if (!strcmp(key, "jerk")) {
+			jerkConf = atoi(value);
+		} else if (!strcmp(key, "junctionDeviation")) {
+			junctionDeviationConf = atoi(value);
+		} else if (!strcmp(key, "maxDeviation")) {
+			maxDeviationConf = atoi(value);
+		} else if (!strcmp(key, "arcTolerance")) {
+			arcToleranceConf = atoi(value);
+		} else if (!strcmp(key, "simplifyTolerance")) {
+			simplifyToleranceConf = atoi(value);
+		} else if (!strcmp(key, "liftThreshold")) {
+			liftThresholdConf = atoi(value);
 		} else if (!strcmp(key, "sheetWidth")) {
 			sheetWidthConf = atoi(value);
 		} else if (!strcmp(key, "sheetHeight")) {
@@ -604,6 +1513,10 @@ void Drawall::loadParameters() {
 			drawingInsertConf = atoi(value);
 		} else if (!strcmp(key, "movingInsert")) {
 			movingInsertConf = atoi(value);
+		} else if (!strcmp(key, "penPreDelay")) {
+			penPreDelayConf = atoi(value);
+		} else if (!strcmp(key, "penPostDelay")) {
+			penPostDelayConf = atoi(value);
 		} else if (!strcmp(key, "initPosX")) {
 			initPosXConf = atoi(value);
 		} else if (!strcmp(key, "initPosY")) {
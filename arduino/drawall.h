@@ -19,6 +19,12 @@
 #define _H_DRAWALL
 
 #include "plotter.h"
+#include "motors.h"
+#include "planner.h"
+#include "kinematics.h"
+#include "drawing.h"
+#include "profiler.h"
+#include "seriallink.h"
 #include <math.h>
 #include <SD.h>
 #include <Servo.h>
@@ -28,6 +34,18 @@
 #define START_WITH_BUTTON 1
 #define START_WITH_SERIAL 2
 
+/// Size of the buffer used to read the drawing file, in bytes.
+#define READ_BUFFER_SIZE 64
+
+/// Maximum number of consecutive points merged by the lines simplification.
+#define SIMPLIFY_WINDOW_SIZE 8
+
+/// Number of records in the checkpoint file, written in turn.
+#define CHECKPOINT_NB_SLOTS 8
+
+/// Space of a record in the checkpoint file, in bytes: one SD card block, so each write only wears its own block.
+#define CHECKPOINT_SLOT_SIZE 512
+
 /**
  * Main library class.
  */
@@ -71,11 +89,18 @@ public:
 	 * End the drawing.
 	 * Used in the end of the drawing:
 	 * - position the plotter on the end position (at the bottom of the sheet by default);
-	 * - disable the motors;
-	 * - pause the program.
+	 * - disable the motors.
+	 * Then the plotter is idle (see idle()).
 	 */
 	void end();
 
+	/**
+	 * Wait for the next drawing, to call repeatedly once the plotter has been started.
+	 * A drawing sent by the computer is drawn as soon as it is received, whatever the startup event. The
+	 * job list file is only read at startup: a new job list needs a restart.
+	 */
+	void idle();
+
 	/********************
 	 * Getters & setters *
 	 ********************/
@@ -88,6 +113,13 @@ public:
 	 */
 	float getDelay(unsigned int speed);
 
+	/**
+	 * Get the step events rate matching the speed, as used by the step generator (see Motors::Block).
+	 * \param speed The belt speed, in mm/s.
+	 * \return The rate, capped to one step by interrupt.
+	 */
+	unsigned long getRate(unsigned int speed);
+
 	/**
 	 * Set the step mode, on the motors drivers.
 	 */
@@ -112,6 +144,17 @@ public:
 	 */
 	void line(float x, float y);
 
+	/**
+	 * Draw an arc of circle, from the actual position to the absolute position [\a x; \a y], split in lines
+	 * according to the arc tolerance. An arc which ends at its start is a full circle.
+	 * \param x The horizontal absolute position of the destination point.
+	 * \param y The vertical absolute position of the destination point.
+	 * \param i The horizontal position of the center, according to the actual position.
+	 * \param j The vertical position of the center, according to the actual position.
+	 * \param isClockwise \a true to turn clockwise, \a false to turn counterclockwise.
+	 */
+	void arc(float x, float y, float i, float j, bool isClockwise);
+
 	/**
 	 * Draw a rectangle matching with the limits of the drawing.
 	 */
@@ -119,6 +162,9 @@ public:
 
 	/**
 	 * Draw a drawing as descibed in the \a fileName file stored int the SD card.
+	 * The file is either a GCode file, or a binary drawing file (see drawing.h).
+	 * If the last drawing of this file has been interrupted, it is resumed from its last checkpoint (see
+	 * checkpointPeriodConf). The plotter stays powered at the end of the drawing, for the next one.
 	 * \param fileName Le nom du fichier gcode à dessiner.
 	 * TODO Check the M02 presence (end of drawing) before the end of drawing.
 	 */
@@ -129,6 +175,22 @@ private:
 	/// Configuration file name
 	const char *CONFIG_FILE_NAME = "config";
 
+	/// Checkpoint file name, removed once the drawing is finished.
+	const char *CHECKPOINT_FILE_NAME = "resume";
+
+	/**
+	 * Job list file name. If this file is on the SD card, its drawings are drawn one after the other,
+	 * instead of the one of drawingNameConf. Each line is a job, made of fields separated by spaces:
+	 * - the drawing file name;
+	 * - the position of the drawing on the sheet, horizontal then vertical, in millimeters (0 by default);
+	 * - the drawing scale, in percents of the scale fitting the sheet (100 by default);
+	 * - the pause before the drawing, to change the pen, in seconds (0 by default).
+	 * For example "flower 100 50 40 30". The empty lines and the ones starting with # are ignored. A job
+	 * whose position or pause is negative or not a number, or whose scale is not greater than 0, is skipped
+	 * with WARN_WRONG_JOB_LINE.
+	 */
+	const char *JOBS_FILE_NAME = "jobs";
+
 	/**
 	 * The codes to send to the computer trought the serial link.
 	 * The errors and warnings which should occurs during the program execution.
@@ -170,6 +232,18 @@ private:
 
 		WARN_UNKNOWN_GCODE_FUNCTION, ///< 23. Unknown GCode function in the drawing file;
 		WARN_UNKNOWN_GCODE_PARAMETER,///< 24. Unknown GCode parameter;
+
+		// Telemetry
+
+		DRAW_STEPS,              ///< 25. Steps done since the last report: left and right deltas (2 bytes each, little endian, positive to release the belt) then the pen state (1 byte);
+
+		// Streaming
+
+		DRAW_ACK,                ///< 26. A streamed GCode line has been read and processed: its chars left the serial buffer (not sent with EN_SERIAL_FRAMES);
+
+		// Warnings
+
+		WARN_WRONG_JOB_LINE,     ///< 27. Incorrectly formatted line in the job list file: the job is skipped;
 	} SerialData;
 
 	/*************
@@ -179,20 +253,128 @@ private:
 	/// Instance of the servo, used to drive it with the \a Servo library.
 	Servo servo;
 
+	/// Motion planner, which computes the speed profile of the blocks sent to the motors.
+	Planner planner;
+
+#if EN_LENGTH_TABLE
+	/// Belt lengths grid over the sheet, shared by the two belts.
+	LengthTable lengthTable;
+#endif
+
 	/// The GCode file of the drawing.
 	// TODO: use in local variable
 	File file;
 
-	/// Left belt length, in steps.
+	/// Chunk of the drawing file, read at once from the SD card.
+	char readBuffer[READ_BUFFER_SIZE];
+
+	/// Position of the next char to read in \a readBuffer.
+	byte readIndex;
+
+	/// Number of chars stored in \a readBuffer.
+	byte readLength;
+
+	/// \a true if the drawing is streamed through the serial link instead of read on the SD card.
+	bool isStreaming;
+
+	/// \a true once the end of the streamed drawing (M02 or M30) has been read.
+	bool isStreamEnded;
+
+	/**
+	 * A record of the checkpoint file, to resume an interrupted drawing. It is taken when the pen is lifted
+	 * by a move, once the previous lines are drawn, so the pen is up at the checkpoint.
+	 */
+	typedef struct {
+		unsigned long number;      ///< Number of the checkpoint in the drawing, from 1: the last one is the greatest.
+		char drawingName[15];      ///< The drawing file name (see drawingNameConf).
+		unsigned long fileSize;    ///< The drawing file size, in bytes.
+		unsigned long jobOffset;   ///< Position of the job in the job list file (see jobOffset).
+		unsigned long offset;      ///< Position in the drawing file of the line (or record) following the move.
+		float posX;                ///< Horizontal position of the move destination, in drawing units.
+		float posY;                ///< Vertical position of the move destination, in drawing units.
+		long recordPosX;           ///< Current point of a binary drawing (see recordPosX).
+		long recordPosY;           ///< Current point of a binary drawing (see recordPosY).
+		unsigned long leftLength;  ///< Left belt length at the move destination, in steps.
+		unsigned long rightLength; ///< Right belt length at the move destination, in steps.
+		uint16_t crc;              ///< CRC of the previous bytes (see frameCrc()), against torn writes.
+	} Checkpoint;
+
+	/// \a true while the drawing file is read, with checkpoints enabled.
+	bool canCheckpoint;
+
+	/// Number of the last checkpoint, 0 if none.
+	unsigned long checkpointNumber;
+
+	/// Time of the last checkpoint, or of the drawing start, in milliseconds.
+	unsigned long lastCheckpointTime;
+
+	/// Position in the job list file of the running job line, 0 without job list.
+	unsigned long jobOffset;
+
+	/// Position in the job list file of the line following the running job.
+	unsigned long nextJobOffset;
+
+	/// Scale of the running drawing, in percents of the scale fitting the sheet (see initScale()).
+	unsigned int jobScale;
+
+	/// \a true once a drawing has been drawn: the next ones start where it has left the pen.
+	bool hasDrawn;
+
+	/// Horizontal position of the current point of a binary drawing, in thousandths of drawing unit.
+	long recordPosX;
+
+	/// Vertical position of the current point of a binary drawing, in thousandths of drawing unit.
+	long recordPosY;
+
+	/// Points dropped by the lines simplification since the last drawn point, kept to check the next lines.
+	float windowX[SIMPLIFY_WINDOW_SIZE];
+
+	/// Vertical positions of the points of \a windowX.
+	float windowY[SIMPLIFY_WINDOW_SIZE];
+
+	/// Number of points in \a windowX and \a windowY.
+	byte windowLength;
+
+	/// \a true if a line to the pending point is waiting to be drawn, or merged with the next one.
+	bool hasPendingPoint;
+
+	/// Horizontal position of the pending point.
+	float pendingX;
+
+	/// Vertical position of the pending point.
+	float pendingY;
+
+	/// \a true if a short pen-up move is waiting to be drawn with the pen down, or done with the pen up.
+	bool hasPendingHop;
+
+	/// Horizontal position of the pending pen-up move destination.
+	float hopX;
+
+	/// Vertical position of the pending pen-up move destination.
+	float hopY;
+
+	/// Number of pen lifts avoided by drawing short pen-up moves with the pen down.
+	unsigned int savedPenCycles;
+
+	/// Left belt length at the end of the last queued block, in steps.
 	unsigned long leftLength;
 
-	/// Right belt length, in steps.
+	/// Right belt length at the end of the last queued block, in steps.
 	unsigned long rightLength;
 
-	/// Horizontal offset. Can be used to calibrate the drawing in a accurate position.
+	/// Left belt length already sent to the computer, in steps.
+	unsigned long reportedLeftLength;
+
+	/// Right belt length already sent to the computer, in steps.
+	unsigned long reportedRightLength;
+
+	/// Time of the last step report, in milliseconds.
+	unsigned long lastReportTime;
+
+	/// Horizontal position of the running drawing on the sheet, in millimeters.
 	unsigned int offsetX;
 
-	/// Vertical offset. Can be used to calibrate the drawing in a accurate position.
+	/// Vertical position of the running drawing on the sheet, in millimeters.
 	unsigned int offsetY;
 
 	/// Drawing scale. Can be used to calibrate the drawing in a accurate scale.
@@ -212,9 +394,29 @@ private:
 	/// The delay concerning the other motor is calculaed in such a way as to the 2 motors are synchronised, that is, they finishes the line on the same time.
 	float delayBetweenSteps;
 
-	/// The robot is currently writing (\a true) or not (\a false).
+
+	/// The robot is currently writing (\a true) or not (\a false), or will be once the pen moved.
 	bool isWriting;
 
+	/// Pen move states, see updatePen().
+	enum PenState {
+		PEN_IDLE,     ///< The pen is in position.
+		PEN_WAITING,  ///< The motors are stopped, the servo-motor waits to move.
+		PEN_SETTLING  ///< The servo-motor moves.
+	};
+
+	/// The current pen move state.
+	PenState penState;
+
+	/// Time when the current pen move started, in milliseconds.
+	unsigned long penStartTime;
+
+	/// Delay before the servo-motor moves, for the current pen move, in milliseconds.
+	unsigned int penPreDelay;
+
+	/// Delay for the servo-motor to reach its position, for the current pen move, in milliseconds.
+	unsigned int penPostDelay;
+
 	/************
 	 * Positions *
 	 ************/
@@ -270,6 +472,19 @@ private:
 	 */
 	unsigned int drawingPosYConf;
 
+	/**
+	 * Checkpoint period
+	 * Minimum delay between two checkpoints of the drawing on the SD card, taken when the pen is lifted.
+	 * When a drawing of the card is interrupted (power cut, jam, reset...), it is resumed from its last
+	 * checkpoint at the next start, once the plotter is back at its initial position. Remove the resume
+	 * file from the card to draw it from the beginning instead. The checkpoints are written in turn on
+	 * CHECKPOINT_NB_SLOTS blocks of the card, which limits its wear. 0 disables the checkpoints.
+	 * Unit: seconds
+	 * Default value: 60 s
+	 * Range: [0 s, 3600 s]
+	 */
+	unsigned int checkpointPeriodConf;
+
 	// *** 2. Installation ***
 
 	// * 2.1 General *
@@ -285,11 +500,14 @@ private:
 
 	/**
 	 * Start-up mode
-	 * Specify which event starts the drawing.
+	 * Specify which event starts the drawing. With serial, the drawing is not read on the SD card but
+	 * streamed by the computer, which counts the DRAW_ACK sent after each GCode line, or the acknowledged
+	 * frames with EN_SERIAL_FRAMES (see tools/stream). With any event, the drawings streamed once the first
+	 * one is done are drawn (see idle()).
 	 * Unit: -
 	 * Default value: Delay
 	 * Range: [0 = Delay, 1 = pushButton, 2 = serial]
-	 * TODO unused yet
+	 * TODO push button unused yet
 	 */
 	byte startupEventConf;
 
@@ -312,6 +530,74 @@ private:
 	 */
 	unsigned int maxSpeedConf;
 
+	/**
+	 * Acceleration
+	 * Maximum acceleration of the belts. 0 disables the acceleration, that is the motors start and stop at
+	 * the maximum speed.
+	 * Unit: millimeters by second squared
+	 * Default value: 200 mm/s²
+	 * Range: [0 mm/s², 5000 mm/s²]
+	 */
+	unsigned int accelerationConf;
+
+	/**
+	 * Jerk
+	 * Belt speed from which the motors can start or stop without acceleration.
+	 * Unit: millimeters by second
+	 * Default value: 5 mm/s
+	 * Range: [0 mm/s, maxSpeed]
+	 */
+	unsigned int jerkConf;
+
+	/**
+	 * Junction deviation
+	 * Distance between the junction of two lines and the curve the plotter can follow at the junction speed.
+	 * The greater it is, the faster the plotter goes through the corners of the drawing.
+	 * Unit: micrometers
+	 * Default value: 50 µm
+	 * Range: [0 µm, 1000 µm]
+	 */
+	unsigned int junctionDeviationConf;
+
+	/**
+	 * Maximum deviation
+	 * Maximum distance between a drawn line and the path followed by the pen. The belts lengths are not
+	 * linear on the sheet, so the lines are split in segments short enough to stay under this distance.
+	 * Unit: micrometers
+	 * Default value: 50 µm
+	 * Range: [1 µm, 1000 µm]
+	 */
+	unsigned int maxDeviationConf;
+
+	/**
+	 * Arc tolerance
+	 * Maximum distance between an arc of the drawing (G02 and G03) and the lines which replace it.
+	 * Unit: micrometers
+	 * Default value: 50 µm
+	 * Range: [1 µm, 1000 µm]
+	 */
+	unsigned int arcToleranceConf;
+
+	/**
+	 * Simplification tolerance
+	 * Maximum distance between a point of the drawing and the line which replaces it, when consecutive
+	 * lines are merged because they are almost aligned. 0 disables the simplification.
+	 * Unit: micrometers
+	 * Default value: 100 µm
+	 * Range: [0 µm, 1000 µm]
+	 */
+	unsigned int simplifyToleranceConf;
+
+	/**
+	 * Lift threshold
+	 * Pen-up moves up to this length, between two lines, are drawn with the pen down instead of lifting
+	 * the pen. The moves which do not change the position never lift the pen, even with 0.
+	 * Unit: micrometers
+	 * Default value: 200 µm
+	 * Range: [0 µm, 5000 µm]
+	 */
+	unsigned int liftThresholdConf;
+
 	// * 2.2 Sheet position and dimensions *
 
 	/**
@@ -370,6 +656,27 @@ private:
 	 */
 	unsigned int movingInsertConf;
 
+	/**
+	 * Pen pre-move delay
+	 * Delay before the servo-motor moves, to let the plotter stop swinging. It is given for a travel
+	 * between the minimum and the maximum servo angles, and scaled to the actual travel.
+	 * Unit: milliseconds
+	 * Default value: 750 ms
+	 * Range: [0 ms, 5000 ms]
+	 */
+	unsigned int penPreDelayConf;
+
+	/**
+	 * Pen post-move delay
+	 * Delay for the servo-motor to reach its position. It is given for a travel between the minimum
+	 * and the maximum servo angles, and scaled to the actual travel. The motors wait for the end of
+	 * this delay when the pen comes close to the sheet, but not when it keeps away.
+	 * Unit: milliseconds
+	 * Default value: 750 ms
+	 * Range: [0 ms, 5000 ms]
+	 */
+	unsigned int penPostDelayConf;
+
 	// *** 3. Advanced parameters ***
 
 	// * 3.1 Plotter positions *
@@ -474,6 +781,36 @@ private:
 	 */
 	void initScale(DrawingSize size);
 
+	/**
+	 * Set the current position from the belt lengths, in the coordinates of the drawing, once its scale and
+	 * offsets are known.
+	 */
+	void initPosition();
+
+	/**
+	 * Draw the drawings of the job list file, one after the other (see JOBS_FILE_NAME).
+	 * An interrupted job list goes on with the job of the last checkpoint. The serial link is not read
+	 * meanwhile: a drawing sent by the computer is drawn once the job list is done (see idle()), but the
+	 * job list itself is not read again.
+	 */
+	void drawJobs();
+
+	/**
+	 * Read the next job of the job list file: set the drawing name, offsets and scale.
+	 * \param pause Set to the pause before the job, in seconds.
+	 * \return \a false if there is no job left.
+	 */
+	bool loadJob(unsigned int *pause);
+
+	/**
+	 * Read the next field of the job line being read by loadJob().
+	 * \param value Set to the field value, or to \a defaultValue if the field is missing.
+	 * \param defaultValue The value of a missing field.
+	 * \param minValue The smallest value of the field.
+	 * \return \a false if the field is not a number between \a minValue and the greatest unsigned int.
+	 */
+	bool readJobField(unsigned int *value, unsigned int defaultValue, unsigned int minValue);
+
 	/**
 	 * Initialize the ratio of number of steps to distance.
 	 * Calculated with the pinion diameter and the number of steps.
@@ -517,16 +854,20 @@ private:
 	 *******************/
 
 	/**
-	 * Rotate the left motor for one step.
-	 * \param pull direction of rotation: \a true to pull the belt, \a false to release the belt.
+	 * Send to the computer the steps done by the motors since the last call.
+	 * Only write what fits in the serial transmit buffer, which is drained by the serial interrupt, so it
+	 * never blocks the drawing. The steps which do not fit are sent on the next calls.
+	 * Without EN_STEP_BYTES, the steps are sent as net deltas in a DRAW_STEPS report, at most once by
+	 * SERIAL_REPORT_PERIOD. With EN_SERIAL_FRAMES, they are state snapshots, taken at most once by
+	 * SERIAL_FRAMES_REPORT_PERIOD, and the pending frames are sent.
+	 * \return \a true if all the steps done by the motors have been sent, with the pending frames.
 	 */
-	void leftStep(bool shouldPull);
+	bool reportSteps();
 
 	/**
-	 * Rotate the right motor for one step.
-	 * \param pull direction of rotation: \a true to pull the belt, \a false to release the belt.
+	 * Send the buffered moves to the motors and wait until they have all been executed.
 	 */
-	void rightStep(bool shouldPull);
+	void waitForMotors();
 
 	/**
 	 * Enable or disable the motors.
@@ -542,19 +883,28 @@ private:
 
 	/**
 	 * Calculate the left belt length for the position [\a x ; \a y].
-	 * \param x The horizontal absolute coordinate of the point.
-	 * \param y The vertical absolute coordinate of the point.
+	 * \param x The horizontal absolute coordinate of the point, in micrometers.
+	 * \param y The vertical absolute coordinate of the point, in micrometers.
 	 * \return The left belt length for the given position (in steps number).
 	 */
-	long positionToLeftLength(float x, float y);
+	long positionToLeftLength(long x, long y);
 
 	/**
 	 * Calculate the right belt length for the position [\a x ; \a y].
-	 * \param x The horizontal absolute coordinate of the point.
-	 * \param y The vertical absolute coordinate of the point.
+	 * \param x The horizontal absolute coordinate of the point, in micrometers.
+	 * \param y The vertical absolute coordinate of the point, in micrometers.
 	 * \return The right belt length for the given position (in steps number).
 	 */
-	long positionToRightLength(float x, float y);
+	long positionToRightLength(long x, long y);
+
+	/**
+	 * Calculate the position matching the belts lengths.
+	 * \param left The left belt length, in steps.
+	 * \param right The right belt length, in steps.
+	 * \param posX Set to the horizontal absolute coordinate of the point, in micrometers.
+	 * \param posY Set to the vertical absolute coordinate of the point, in micrometers.
+	 */
+	void lengthsToPosition(float left, float right, float *posX, float *posY);
 
 	/******************
 	 * SD card reading *
@@ -568,24 +918,161 @@ private:
 	 */
 	void sdInit(char *fileName);
 
+	/**
+	 * Open the drawing file and reset the read buffer, unless the drawing is streamed.
+	 * Could throw error FILE_NOT_FOUND (see Drawall::Error)
+	 */
+	void openDrawing();
+
+	/**
+	 * Check if there are some chars left in the drawing file, or if the streamed drawing is not ended.
+	 */
+	bool isReadable();
+
+	/**
+	 * Read the next char of the drawing file, or of the serial link when the drawing is streamed.
+	 * The file is read by chunks of \a READ_BUFFER_SIZE bytes, which saves the SD library single-byte path
+	 * on each char. The serial link is waited for, while the motors keep running.
+	 * \return The read char, or a new line if the end of the file is reached.
+	 */
+	char readChar();
+
+	/**
+	 * Check if the drawing file is a binary drawing file, by reading its magic.
+	 * If not, the read buffer is rewound to the beginning of the file.
+	 */
+	bool isBinaryDrawing();
+
+	/**
+	 * Read a little endian integer in the drawing file.
+	 * \param size The integer size, 2 or 4 bytes.
+	 * \return The signed integer.
+	 */
+	long readInteger(byte size);
+
+	/**
+	 * Draw all the records of a binary drawing file, whose header has been read.
+	 * The points are sent straight to the planner, without any text parsing.
+	 */
+	void processBinaryRecords();
+
+	/**
+	 * Resume the drawing from its last checkpoint, if any: move to the checkpoint position and skip the
+	 * drawing file to the checkpoint offset. Otherwise, clear the checkpoint file for a new drawing.
+	 * To call once the drawing scale is known.
+	 */
+	void initCheckpoints();
+
+	/**
+	 * Write a checkpoint on the SD card, if the checkpoint period is over. To call right after the
+	 * pen-up move which has lifted the pen, or when the pen is up and the lines are drawn.
+	 * \param isForced \a true to write it whatever the checkpoint period.
+	 */
+	void checkpoint(bool isForced = false);
+
+	/**
+	 * Read the last checkpoint of the checkpoint file, among the ones matching their CRC.
+	 * \param checkpoint Set to the checkpoint.
+	 * \return \a false if there is none.
+	 */
+	bool readCheckpoint(Checkpoint *checkpoint);
+
+	/**
+	 * Read the last checkpoint of the checkpoint file.
+	 * \param checkpoint Set to the checkpoint.
+	 * \return \a true if it belongs to the drawing and job, with the same plotter geometry.
+	 */
+	bool loadCheckpoint(Checkpoint *checkpoint);
+
+	/**
+	 * Set the belt lengths of a checkpoint, from its position, with the current geometry.
+	 */
+	void setCheckpointLengths(Checkpoint *checkpoint);
+
+	/**
+	 * Get the CRC of a checkpoint, without its \a crc field.
+	 */
+	uint16_t getCheckpointCrc(Checkpoint *checkpoint);
+
+	/**
+	 * Read a decimal number in the drawing file, as a fixed-point value.
+	 * Handles the sign and up to 3 decimals (the next ones are ignored), without any float operation.
+	 * \param car Set to the char following the number.
+	 * \return The number, in thousandths.
+	 */
+	long readNumber(char *car);
+
 	/**
 	 * Interpret the current GCode function.
 	 * The cursor need to be just before a GCode function. Ignore white spaces before the function name.
+	 * The X and Y parameters are the destination point, the Z parameter raises the pen if positive,
+	 * the I and J parameters are the center of the G02 and G03 arcs, according to the current point,
+	 * and the P parameter (or X if there is no P) is the G04 delay in seconds.
 	 */
 	void processSDLine();
 
 	/**
 	 * Draw a straight line from the current point to the point [\a x ; \a y].
+	 * The line is queued to the step generator, then this returns as soon as there is a free slot in the queue.
 	 * \param shouldWrite: the pen state, that is, \true to write and \false to move.
 	 */
 	void segment(float x, float y, bool shouldWrite);
 
+	/**
+	 * Draw a straight line from the current point to the point [\a x ; \a y], whose belts lengths are already known.
+	 * \param leftTargetLength The left belt length at the point [\a x ; \a y], in steps.
+	 * \param rightTargetLength The right belt length at the point [\a x ; \a y], in steps.
+	 */
+	void segment(float x, float y, unsigned long leftTargetLength, unsigned long rightTargetLength);
+
+	/**
+	 * Draw a straight line, from the actual position to the absolute position [\a x; \a y], without
+	 * simplification. The line is split according to the maximum deviation.
+	 */
+	void drawLine(float x, float y);
+
+	/**
+	 * Get the destination of the last line or move, which may be still pending.
+	 */
+	void getLastPoint(float *x, float *y);
+
+	/**
+	 * Draw the line to the pending point, or do the pending pen-up move, if any.
+	 * Must be called before anything else than a line, since the last line or move may be still pending.
+	 */
+	void flushLine();
+
+	/**
+	 * Check if the pending point and the window points are close enough to the line from the current point
+	 * to the point [\a x ; \a y] to be dropped, according to the simplification tolerance.
+	 */
+	bool isSimplifiable(float x, float y);
+
+	/**
+	 * Get the distance between the middle of the line from the current point to the point [\a x ; \a y],
+	 * and the point reached by the pen when the motors are at the middle of this line.
+	 * \param x The horizontal absolute position of the destination point.
+	 * \param y The vertical absolute position of the destination point.
+	 * \param leftTargetLength Set to the left belt length at the destination point, in steps.
+	 * \param rightTargetLength Set to the right belt length at the destination point, in steps.
+	 * \return The deviation, in micrometers.
+	 */
+	float getDeviation(float x, float y, unsigned long *leftTargetLength, unsigned long *rightTargetLength);
+
 	/**
 	 * Come close or keep away the pen from the sheet.
 	 * \param shouldWrite \a true to come close the pen to the sheet (writing), \a false to keep away (moving).
 	 */
 	void writingPen(bool shouldWrite);
 
+	/**
+	 * Move the pen forward, without blocking: move the servo-motor once the pre-move delay is over, then
+	 * release the motors, as soon as the servo-motor moves when the pen keeps away, or once the post-move
+	 * delay is over when the pen comes close.
+	 * \return \a true if the pen is in position.
+	 */
+	bool updatePen();
+
 	/**
 	 * Send a message to the GUI
 	 */
@@ -0,0 +1,49 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Binary drawing file format, shared by the plotter and the computer tools.
+ * All the integers are little endian, and the coordinates are in thousandths of drawing unit.
+ * - Header: the 4 chars magic "DWB1", then the drawing width and height (4 bytes each);
+ * - Records: one opcode byte, followed by its operands, until the DWB_END opcode.
+ * This file must not depend on Arduino.h.
+ */
+
+#ifndef _H_DRAWING
+#define _H_DRAWING
+
+/// Magic chars at the beginning of a binary drawing file.
+#define DWB_MAGIC "DWB1"
+
+/// Size of the magic, in bytes.
+#define DWB_MAGIC_LENGTH 4
+
+/// End of the drawing.
+#define DWB_END 0
+
+/// Keep away the pen from the sheet for the next points.
+#define DWB_PEN_UP 1
+
+/// Come close the pen to the sheet for the next points.
+#define DWB_PEN_DOWN 2
+
+/// Go to a point relative to the previous one, followed by the horizontal and vertical deltas (2 bytes each).
+#define DWB_DELTA 3
+
+/// Go to an absolute point, followed by its horizontal and vertical coordinates (4 bytes each).
+#define DWB_POINT 4
+
+/// Wait, followed by the delay in milliseconds (2 bytes).
+#define DWB_WAIT 5
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Serial link frames file.
+ */
+
+#include <frame.h>
+#include <string.h>
+
+uint16_t frameCrc(uint16_t crc, uint8_t data) {
+	crc ^= (uint16_t) data << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+void FrameEncoder::begin(uint8_t type) {
+	frame[0] = FRAME_SYNC;
+	frame[1] = 0;
+	frame[2] = type;
+}
+
+bool FrameEncoder::add(uint8_t data) {
+	if (frame[1] == FRAME_MAX_PAYLOAD) {
+		return false;
+	}
+	frame[4 + frame[1]++] = data;
+	return true;
+}
+
+uint8_t FrameEncoder::getLength() {
+	return frame[1];
+}
+
+uint8_t FrameEncoder::end(uint8_t seq) {
+	uint8_t length = frame[1];
+	frame[3] = seq;
+
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 1; i < 4 + length; i++) {
+		crc = frameCrc(crc, frame[i]);
+	}
+	frame[4 + length] = crc & 0xFF;
+	frame[5 + length] = crc >> 8;
+
+	return length + FRAME_OVERHEAD;
+}
+
+const uint8_t *FrameEncoder::getFrame() {
+	return frame;
+}
+
+FrameDecoder::FrameDecoder() {
+	size = 0;
+	frameSize = 0;
+	nbErrors = 0;
+}
+
+void FrameDecoder::skip(uint8_t nbBytes) {
+	while (nbBytes < size && bytes[nbBytes] != FRAME_SYNC) {
+		nbBytes++;
+	}
+	size -= nbBytes;
+	memmove(bytes, bytes + nbBytes, size);
+}
+
+FrameStatus FrameDecoder::decode() {
+	bool isCorrupted = false;
+
+	while (size > 1) {
+		uint8_t length = bytes[1];
+		if (length <= FRAME_MAX_PAYLOAD) {
+			if (size < length + FRAME_OVERHEAD) {
+				break;
+			}
+
+			uint16_t crc = 0xFFFF;
+			for (uint8_t i = 1; i < length + 4; i++) {
+				crc = frameCrc(crc, bytes[i]);
+			}
+			if (bytes[length + 4] == (crc & 0xFF) && bytes[length + 5] == crc >> 8) {
+				frameSize = length + FRAME_OVERHEAD;
+				return FRAME_COMPLETE;
+			}
+		}
+
+		// Search the next frame after the FRAME_SYNC of the corrupted one.
+		nbErrors++;
+		isCorrupted = true;
+		skip(1);
+	}
+
+	return isCorrupted ? FRAME_CORRUPTED : FRAME_INCOMPLETE;
+}
+
+FrameStatus FrameDecoder::push(uint8_t data) {
+	skip(frameSize);
+	frameSize = 0;
+
+	if (size == 0 && data != FRAME_SYNC) {
+		return FRAME_INCOMPLETE;
+	}
+	bytes[size++] = data;
+	return decode();
+}
+
+FrameStatus FrameDecoder::next() {
+	skip(frameSize);
+	frameSize = 0;
+	return decode();
+}
+
+uint8_t FrameDecoder::getType() {
+	return bytes[2];
+}
+
+uint8_t FrameDecoder::getSeq() {
+	return bytes[3];
+}
+
+uint8_t FrameDecoder::getLength() {
+	return bytes[1];
+}
+
+const uint8_t *FrameDecoder::getPayload() {
+	return bytes + 4;
+}
+
+unsigned long FrameDecoder::getNbErrors() {
+	return nbErrors;
+}
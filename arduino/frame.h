@@ -0,0 +1,190 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Frames of the serial link (EN_SERIAL_FRAMES, see plotter.h), shared by the plotter and the computer
+ * tools, so it does not depend on the Arduino core. A frame is made of:
+ * - FRAME_SYNC;
+ * - the payload length, up to FRAME_MAX_PAYLOAD;
+ * - the frame type (see FrameType);
+ * - a sequence number, incremented on each frame sent in the same direction;
+ * - the payload;
+ * - the CRC-16 (polynomial 0x1021, initial value 0xFFFF) of the length, type, sequence number and
+ * payload, low byte first.
+ */
+
+#ifndef _H_FRAME
+#define _H_FRAME
+
+#include <stdint.h>
+
+/// First byte of each frame.
+#define FRAME_SYNC 0xA5
+
+/// Maximum payload length. Two full frames fit in the 64 bytes receive buffer of the plotter.
+#define FRAME_MAX_PAYLOAD 26
+
+/// Size of a frame without its payload.
+#define FRAME_OVERHEAD 6
+
+/// Maximum size of a frame.
+#define FRAME_MAX_SIZE (FRAME_MAX_PAYLOAD + FRAME_OVERHEAD)
+
+/// Size of a state snapshot in a FRAME_STATE payload.
+#define FRAME_STATE_SIZE 5
+
+/**
+ * Frame types.
+ */
+typedef enum {
+	// Sent by the plotter
+	FRAME_DATA = 1,  ///< Bytes of the legacy serial stream (see Drawall::SerialData), messages included.
+	FRAME_STATE = 2, ///< State snapshots: left and right belt steps since the previous one (2 bytes each, low byte first, positive to release the belt), then 1 if the pen is writing.
+	FRAME_ACK = 3,   ///< A frame has been received: its sequence number, then the number of bytes read since the start (2 bytes, low byte first), which gives the room in the receive buffer.
+	FRAME_NACK = 4,  ///< A frame has been lost: the sequence number to send again from, then the number of bytes read, as FRAME_ACK.
+
+	// Sent by the computer
+	FRAME_GCODE = 16 ///< Chars of a streamed GCode drawing. A line can be split on several frames.
+} FrameType;
+
+/**
+ * Result of FrameDecoder::push().
+ */
+typedef enum {
+	FRAME_INCOMPLETE, ///< More bytes are needed.
+	FRAME_COMPLETE,   ///< A valid frame has been received.
+	FRAME_CORRUPTED   ///< A frame has been dropped, because of a wrong length or CRC.
+} FrameStatus;
+
+/**
+ * Update a frame CRC with a byte.
+ */
+uint16_t frameCrc(uint16_t crc, uint8_t data);
+
+/**
+ * Build a frame in place, so it is sent without copy.
+ */
+class FrameEncoder {
+
+public:
+
+	/**
+	 * Start an empty frame.
+	 * \param type The frame type (see FrameType).
+	 */
+	void begin(uint8_t type);
+
+	/**
+	 * Add a byte at the end of the payload.
+	 * \return \a false if the payload is full, then the byte is not added.
+	 */
+	bool add(uint8_t data);
+
+	/**
+	 * Get the payload length.
+	 */
+	uint8_t getLength();
+
+	/**
+	 * Write the sequence number and the CRC.
+	 * \param seq The sequence number of the frame.
+	 * \return The size of the frame.
+	 */
+	uint8_t end(uint8_t seq);
+
+	/**
+	 * Get the frame bytes, valid after end().
+	 */
+	const uint8_t *getFrame();
+
+private:
+
+	/// The frame, starting with FRAME_SYNC.
+	uint8_t frame[FRAME_MAX_SIZE];
+};
+
+/**
+ * Find the frames in a stream of bytes.
+ * After a corrupted frame, the bytes following its FRAME_SYNC are searched again for a frame, so a
+ * corrupted length never hides the next frame.
+ */
+class FrameDecoder {
+
+public:
+
+	FrameDecoder();
+
+	/**
+	 * Decode a received byte.
+	 * \return FRAME_COMPLETE once a frame has been received: it is readable until the next call.
+	 */
+	FrameStatus push(uint8_t data);
+
+	/**
+	 * Decode the bytes received after the last frame, which can hold another frame when the last one has
+	 * been found after a corrupted frame. To call after each FRAME_COMPLETE, until another result.
+	 * \return Same as push().
+	 */
+	FrameStatus next();
+
+	/**
+	 * Get the type of the received frame.
+	 */
+	uint8_t getType();
+
+	/**
+	 * Get the sequence number of the received frame.
+	 */
+	uint8_t getSeq();
+
+	/**
+	 * Get the payload length of the received frame.
+	 */
+	uint8_t getLength();
+
+	/**
+	 * Get the payload of the received frame.
+	 */
+	const uint8_t *getPayload();
+
+	/**
+	 * Get the number of corrupted frames since the decoder creation.
+	 */
+	unsigned long getNbErrors();
+
+private:
+
+	/**
+	 * Remove bytes at the beginning of \a bytes, then the ones before the next FRAME_SYNC.
+	 */
+	void skip(uint8_t nbBytes);
+
+	/**
+	 * Find a frame at the beginning of \a bytes, skipping the corrupted ones.
+	 */
+	FrameStatus decode();
+
+	/// The bytes received since the end of the last frame, starting with FRAME_SYNC if not empty.
+	uint8_t bytes[FRAME_MAX_SIZE];
+
+	/// Number of bytes in \a bytes.
+	uint8_t size;
+
+	/// Size of the frame returned by the last call, still at the beginning of \a bytes, or 0.
+	uint8_t frameSize;
+
+	/// Number of corrupted frames.
+	unsigned long nbErrors;
+};
+
+#endif
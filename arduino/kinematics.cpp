@@ -0,0 +1,183 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Kinematics file.
+ */
+
+#include <kinematics.h>
+
+unsigned long floatBeltLength(long dx, long dy) {
+	float x = dx;
+	float y = dy;
+
+	return sqrt(x * x + y * y) * (KIN_STEPS_BY_KM / 1000000000.0);
+}
+
+/**
+ * Multiply by a fraction, with 16 bits products only, which the AVR multiplies in hardware.
+ * \param value The value to multiply.
+ * \param fraction The fraction, with 32 fractional bits.
+ * \return value * fraction / 2^32, rounded down.
+ */
+static unsigned long multiplyFraction(unsigned long value, unsigned long fraction) {
+	uint16_t valueHigh = value >> 16;
+	uint16_t valueLow = value;
+	uint16_t fractionHigh = fraction >> 16;
+	uint16_t fractionLow = fraction;
+	unsigned long high = (unsigned long) valueHigh * fractionHigh;
+	unsigned long middle1 = (unsigned long) valueHigh * fractionLow;
+	unsigned long middle2 = (unsigned long) valueLow * fractionHigh;
+	unsigned long low = (unsigned long) valueLow * fractionLow;
+
+	// The carry of the low halves
+	return high + (middle1 >> 16) + (middle2 >> 16)
+			+ (((middle1 & 0xFFFF) + (middle2 & 0xFFFF) + (low >> 16)) >> 16);
+}
+
+unsigned long integerBeltLength(long dx, long dy) {
+	unsigned long x = labs(dx);
+	unsigned long y = labs(dy);
+
+	// Smallest unit of 2^shift micrometers whose squares sum fits in 31 bits
+	byte shift = 0;
+	while (max(x, y) >> shift >= 1UL << 15) {
+		shift++;
+	}
+	unsigned int unitsX = x >> shift;
+	unsigned int unitsY = y >> shift;
+	unsigned long square = (unsigned long) unitsX * unitsX + (unsigned long) unitsY * unitsY;
+
+	// (u + r / 2^shift)² = u² + 2ur / 2^shift + (r / 2^shift)², whose last term is below 1 unit.
+	if (shift > 0) {
+		unsigned long mask = (1UL << shift) - 1;
+		square += ((unsigned long) unitsX * (x & mask) + (unsigned long) unitsY * (y & mask))
+				>> (shift - 1);
+	}
+
+	// Square root, two bits of the square by root bit, then with zeros for the fractional bits
+	unsigned long root = 0;
+	unsigned long remainder = 0;
+	for (byte i = 0; i < 16 + KIN_ROOT_FRACTION_BITS; i++) {
+		remainder = (remainder << 2) | ((square >> 30) & 3);
+		square <<= 2;
+		root <<= 1;
+		if (remainder >= 2 * root + 1) {
+			remainder -= 2 * root + 1;
+			root++;
+		}
+	}
+
+	// Steps, in units of 2^(shift - KIN_ROOT_FRACTION_BITS) steps
+	unsigned long steps = multiplyFraction(root, KIN_STEPS_BY_UM_FRACTION);
+	if (shift > KIN_ROOT_FRACTION_BITS) {
+		return steps << (shift - KIN_ROOT_FRACTION_BITS);
+	}
+	return steps >> (KIN_ROOT_FRACTION_BITS - shift);
+}
+
+void LengthTable::build(long minDx, long minDy, long maxDx, long maxDy) {
+	originX = minDx;
+	originY = minDy;
+
+	// Smallest cells covering the distances
+	long extent = max(maxDx - minDx, maxDy - minDy);
+	cellShift = 0;
+	while (((long) (KIN_TABLE_SIZE - 1) << cellShift) < extent) {
+		cellShift++;
+	}
+	long cellSize = 1L << cellShift;
+
+	for (byte i = 0; i < KIN_TABLE_SIZE; i++) {
+		for (byte j = 0; j < KIN_TABLE_SIZE; j++) {
+			lengths[i][j] = beltLength(originX + i * cellSize,
+					originY + j * cellSize);
+		}
+	}
+
+	// The second derivatives of sqrt(x² + y²) are y² / l³ and x² / l³.
+	float stepsByMicrometer = KIN_STEPS_BY_KM / 1000000000.0;
+	for (byte i = 0; i < KIN_TABLE_SIZE - 1; i++) {
+		for (byte j = 0; j < KIN_TABLE_SIZE - 1; j++) {
+			float x = originX + (i + 0.5) * cellSize;
+			float y = originY + (j + 0.5) * cellSize;
+			float length = sqrt(x * x + y * y);
+			float factor = stepsByMicrometer * cellSize / 2 * cellSize
+					/ (length * length * length);
+
+			float xCurvature = round(y * y * factor);
+			float yCurvature = round(x * x * factor);
+
+			// Too curved for the corrections size: the cell lengths are computed.
+			if (xCurvature > KIN_TABLE_MAX_CURVATURE
+					|| yCurvature > KIN_TABLE_MAX_CURVATURE) {
+				xCurvatures[i][j] = KIN_TABLE_SATURATED;
+				yCurvatures[i][j] = KIN_TABLE_SATURATED;
+			} else {
+				xCurvatures[i][j] = xCurvature;
+				yCurvatures[i][j] = yCurvature;
+			}
+		}
+	}
+}
+
+long LengthTable::getFraction(long position) {
+	if (cellShift > KIN_TABLE_FRACTION_BITS) {
+		return position >> (cellShift - KIN_TABLE_FRACTION_BITS);
+	}
+	return position << (KIN_TABLE_FRACTION_BITS - cellShift);
+}
+
+long LengthTable::interpolate(long from, long to, long fraction) {
+	long delta = to - from;
+
+	// delta * fraction in two products of 8 bits of the fraction, which fit in 32 bits for deltas up to
+	// 2^23 steps.
+	return from + ((delta * (fraction >> 8) + ((delta * (fraction & 0xFF)) >> 8))
+			>> (KIN_TABLE_FRACTION_BITS - 8));
+}
+
+long LengthTable::getCorrection(int16_t curvature, long fraction) {
+	// curvature * u * (1 - u), with u the position in the cell between 0 and 1
+	return (curvature
+			* ((fraction * ((1L << KIN_TABLE_FRACTION_BITS) - fraction))
+					>> KIN_TABLE_FRACTION_BITS)) >> KIN_TABLE_FRACTION_BITS;
+}
+
+unsigned long LengthTable::getLength(long dx, long dy) {
+	long x = dx - originX;
+	long y = dy - originY;
+
+	if (x < 0 || y < 0 || (x >> cellShift) >= KIN_TABLE_SIZE - 1
+			|| (y >> cellShift) >= KIN_TABLE_SIZE - 1) {
+		return beltLength(dx, dy);
+	}
+
+	byte i = x >> cellShift;
+	byte j = y >> cellShift;
+	if (xCurvatures[i][j] == KIN_TABLE_SATURATED) {
+		return beltLength(dx, dy);
+	}
+
+	// Positions in the cell
+	long u = getFraction(x & ((1L << cellShift) - 1));
+	long v = getFraction(y & ((1L << cellShift) - 1));
+
+	// Bilinear interpolation
+	long bottom = interpolate(lengths[i][j], lengths[i + 1][j], u);
+	long top = interpolate(lengths[i][j + 1], lengths[i + 1][j + 1], u);
+	long length = interpolate(bottom, top, v);
+
+	return length - getCorrection(xCurvatures[i][j], u)
+			- getCorrection(yCurvatures[i][j], v);
+}
@@ -0,0 +1,164 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Kinematics header file.
+ * The distances are given in micrometers and the belt lengths in steps.
+ */
+
+#ifndef _H_KINEMATICS
+#define _H_KINEMATICS
+
+#include "plotter.h"
+#include <Arduino.h>
+
+/// Number of steps by kilometer of belt.
+/// PLT_STEPS * 2 because it is the rising edge which drive the motor steps.
+#define KIN_STEPS_BY_KM ((unsigned long) (PLT_STEPS * 2.0 * (1 << PLT_STEP_MODE) \
+		* 1000000000.0 / (PI * PLT_PINION_DIAMETER)))
+
+/// Steps by micrometer, with 32 fractional bits: a step is longer than a micrometer.
+#define KIN_STEPS_BY_UM_FRACTION ((unsigned long) (KIN_STEPS_BY_KM / 1000000000.0 * 4294967296.0))
+
+/// Number of fractional bits of the square root of integerBeltLength(), in its distance unit.
+#define KIN_ROOT_FRACTION_BITS 10
+
+/**
+ * Get the length of a belt from the horizontal and vertical distances between its extremities, in float.
+ * The 24 bits mantissa keeps it under 0.1 step of the exact length for belts up to 10^6 steps: once
+ * rounded down, it differs from the exact length by at most one step.
+ * \param dx The horizontal distance, in micrometers.
+ * \param dy The vertical distance, in micrometers.
+ * \return The belt length, in steps, rounded down.
+ */
+unsigned long floatBeltLength(long dx, long dy);
+
+/**
+ * Get the length of a belt from the horizontal and vertical distances between its extremities, with 32 bits
+ * integers only. The distances are counted in units of 2^n micrometers, the smallest ones whose squares
+ * fit in 32 bits (64 µm for a 2 m belt), and the bits under the unit are kept in the cross products of
+ * the squares. The square root gets KIN_ROOT_FRACTION_BITS fractional bits, then is converted to steps
+ * with KIN_STEPS_BY_UM_FRACTION. The length is under 0.1 step of the exact length for belts up to 33 m:
+ * once rounded down, it differs from the exact length by at most one step.
+ * \param dx The horizontal distance, in micrometers.
+ * \param dy The vertical distance, in micrometers.
+ * \return The belt length, in steps, rounded down.
+ */
+unsigned long integerBeltLength(long dx, long dy);
+
+/**
+ * Get the length of a belt, with integerBeltLength() if EN_INTEGER_KINEMATICS is enabled, else with
+ * floatBeltLength() (tools/test/kinematics.cpp compares them over the sheet).
+ * \param dx The horizontal distance, in micrometers.
+ * \param dy The vertical distance, in micrometers.
+ * \return The belt length, in steps, rounded down.
+ */
+inline unsigned long beltLength(long dx, long dy) {
+#if EN_INTEGER_KINEMATICS
+	return integerBeltLength(dx, dy);
+#else
+	return floatBeltLength(dx, dy);
+#endif
+}
+
+/// Number of nodes on each side of the belt lengths grid.
+#define KIN_TABLE_SIZE 9
+
+/// Number of fractional bits of the positions in a cell of the belt lengths grid, for its interpolation.
+#define KIN_TABLE_FRACTION_BITS 15
+
+/// Greatest curvature correction of a grid cell, stored on 16 bits.
+#define KIN_TABLE_MAX_CURVATURE 0x7FFF
+
+/// Curvature correction of a grid cell whose correction does not fit in 16 bits.
+#define KIN_TABLE_SATURATED -1
+
+/**
+ * Grid of belt lengths, to get them by interpolation instead of a square root.
+ * The grid is square, with cells whose size is a power of 2 micrometers, so a length is interpolated with
+ * shifts and multiplications only. The belt length is convex, so a bilinear interpolation overestimates it:
+ * each cell keeps the second derivatives of the length at its center, to subtract the quadratic error.
+ * The remaining error grows with the cube of the cell size (tools/lengthtable.cpp measures it): about 17
+ * steps with 9 nodes over the default sheet, 4 steps with 17 nodes.
+ * The corrections are stored on 16 bits: a cell whose correction does not fit is not interpolated, its
+ * lengths are computed with beltLength().
+ * The grid uses KIN_TABLE_SIZE² * 4 + (KIN_TABLE_SIZE - 1)² * 4 bytes of RAM.
+ */
+class LengthTable {
+
+public:
+
+	/**
+	 * Compute the grid, for the given distances between a belt extremities.
+	 * \param minDx The smallest horizontal distance, in micrometers.
+	 * \param minDy The smallest vertical distance, in micrometers.
+	 * \param maxDx The greatest horizontal distance, in micrometers.
+	 * \param maxDy The greatest vertical distance, in micrometers.
+	 */
+	void build(long minDx, long minDy, long maxDx, long maxDy);
+
+	/**
+	 * Get the length of a belt, like beltLength(): interpolated inside the grid, computed outside.
+	 * \param dx The horizontal distance, in micrometers.
+	 * \param dy The vertical distance, in micrometers.
+	 * \return The belt length, in steps.
+	 */
+	unsigned long getLength(long dx, long dy);
+
+private:
+
+	/// Horizontal distance of the first node, in micrometers.
+	long originX;
+
+	/// Vertical distance of the first node, in micrometers.
+	long originY;
+
+	/// The cells size is 2^cellShift micrometers.
+	byte cellShift;
+
+	/// Belt lengths on the nodes, in steps.
+	unsigned long lengths[KIN_TABLE_SIZE][KIN_TABLE_SIZE];
+
+	/// Horizontal quadratic error of the bilinear interpolation, in steps, for each cell: half the second
+	/// derivative of the length, multiplied by the squared cell size. KIN_TABLE_SATURATED if it does not fit.
+	int16_t xCurvatures[KIN_TABLE_SIZE - 1][KIN_TABLE_SIZE - 1];
+
+	/// Vertical quadratic error of the bilinear interpolation, as \a xCurvatures.
+	int16_t yCurvatures[KIN_TABLE_SIZE - 1][KIN_TABLE_SIZE - 1];
+
+	/**
+	 * Get a position in a cell, in fraction of the cell size.
+	 * \param position The position in the cell, in micrometers.
+	 * \return The position, with KIN_TABLE_FRACTION_BITS fractional bits.
+	 */
+	long getFraction(long position);
+
+	/**
+	 * Interpolate linearly between two lengths, with 32 bits products only.
+	 * \param from The length at the beginning of the cell, in steps.
+	 * \param to The length at the end of the cell, in steps.
+	 * \param fraction The position in the cell, with KIN_TABLE_FRACTION_BITS fractional bits.
+	 * \return The length at this position, in steps.
+	 */
+	long interpolate(long from, long to, long fraction);
+
+	/**
+	 * Get the quadratic error of the bilinear interpolation, for a position in a cell.
+	 * \param curvature The error factor of the cell, in steps.
+	 * \param fraction The position in the cell, with KIN_TABLE_FRACTION_BITS fractional bits.
+	 * \return The error, in steps.
+	 */
+	long getCorrection(int16_t curvature, long fraction);
+};
+
+#endif
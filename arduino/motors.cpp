@@ -0,0 +1,239 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Step generator file.
+ */
+
+#include <motors.h>
+#include "pins.h"
+
+// Pins of each motor, once reversed
+#if PLT_REVERSE_MOTORS
+#define MOTORS_LEFT_STEP PIN_RIGHT_MOTOR_STEP
+#define MOTORS_LEFT_DIR PIN_RIGHT_MOTOR_DIR
+#define MOTORS_RIGHT_STEP PIN_LEFT_MOTOR_STEP
+#define MOTORS_RIGHT_DIR PIN_LEFT_MOTOR_DIR
+#else
+#define MOTORS_LEFT_STEP PIN_LEFT_MOTOR_STEP
+#define MOTORS_LEFT_DIR PIN_LEFT_MOTOR_DIR
+#define MOTORS_RIGHT_STEP PIN_RIGHT_MOTOR_STEP
+#define MOTORS_RIGHT_DIR PIN_RIGHT_MOTOR_DIR
+#endif
+
+// The step pins are also written at once, without PINS_WRITE().
+PINS_CHECK(MOTORS_LEFT_STEP);
+PINS_CHECK(MOTORS_RIGHT_STEP);
+
+Motors motors;
+
+ISR(TIMER2_COMPA_vect) {
+#if EN_PROFILING && !defined(PROFILE_HOST)
+	// The timer counter restarts on each compare match, so it holds the interrupt latency.
+	byte latency = TCNT2;
+#endif
+
+	motors.tick();
+
+#if EN_PROFILING && !defined(PROFILE_HOST)
+	// The compare flag is set again if the next interrupt is already due.
+	if (!motors.isIdle()) {
+		profileInterrupt(latency, TIFR2 & _BV(OCF2A));
+	}
+#endif
+}
+
+void Motors::start(unsigned long initLeftLength, unsigned long initRightLength) {
+	leftLength = initLeftLength;
+	rightLength = initRightLength;
+	current = NULL;
+	head = 0;
+	tail = 0;
+	isHeld = false;
+
+	// Start from a known direction, released
+	isLeftPulling = false;
+	isRightPulling = false;
+	PINS_WRITE(MOTORS_LEFT_DIR, !PLT_LEFT_DIRECTION);
+	PINS_WRITE(MOTORS_RIGHT_DIR, !PLT_RIGHT_DIRECTION);
+
+	noInterrupts();
+	TCCR2A = _BV(WGM21); // CTC mode
+	TCCR2B = _BV(CS21); // prescaler 8
+	OCR2A = F_CPU / 8 / MOTORS_FREQUENCY - 1;
+	TIMSK2 |= _BV(OCIE2A);
+	interrupts();
+}
+
+bool Motors::push(const Block &block) {
+	byte next = (head + 1) & (MOTORS_QUEUE_SIZE - 1);
+
+	if (next == tail) {
+		return false;
+	}
+
+	queue[head] = block;
+
+	// The block must be fully copied before the interrupt can see it.
+	noInterrupts();
+	head = next;
+	interrupts();
+
+	return true;
+}
+
+bool Motors::isIdle() {
+	return head == tail;
+}
+
+void Motors::hold(bool shouldHold) {
+	isHeld = shouldHold;
+}
+
+unsigned long Motors::getLeftLength() {
+	unsigned long length;
+
+	noInterrupts();
+	length = leftLength;
+	interrupts();
+
+	return length;
+}
+
+unsigned long Motors::getRightLength() {
+	unsigned long length;
+
+	noInterrupts();
+	length = rightLength;
+	interrupts();
+
+	return length;
+}
+
+void Motors::tick() {
+	if (current == NULL) {
+		if (tail == head || isHeld) {
+			return; // nothing to do
+		}
+
+		current = &queue[tail];
+		accumulator = 0;
+		rate = current->entryRate;
+		stepEvents = current->stepCount;
+		leftCounter = -(long) (stepEvents >> 1);
+		rightCounter = leftCounter;
+
+		if (setDirection(*current)) {
+			// The drivers need a setup time between a direction change and a step: step on the next interrupt.
+			return;
+		}
+	}
+
+	if (current->stepCount - stepEvents < current->accelerateSteps) {
+		rate += current->acceleration;
+		if (rate > current->nominalRate) {
+			rate = current->nominalRate;
+		}
+	} else if (stepEvents <= current->decelerateSteps) {
+		if (rate > current->exitRate + current->acceleration) {
+			rate -= current->acceleration;
+		} else {
+			rate = current->exitRate;
+		}
+	}
+
+	accumulator += rate;
+	if (accumulator >= MOTORS_RATE_ONE) {
+		accumulator -= MOTORS_RATE_ONE;
+
+		bool isLeftStepping = false;
+		bool isRightStepping = false;
+
+		leftCounter += current->leftSteps;
+		if (leftCounter > 0) {
+			leftCounter -= current->stepCount;
+			leftLength += current->pullLeft ? -1 : 1;
+			isLeftStepping = true;
+		}
+
+		rightCounter += current->rightSteps;
+		if (rightCounter > 0) {
+			rightCounter -= current->stepCount;
+			rightLength += current->pullRight ? -1 : 1;
+			isRightStepping = true;
+		}
+
+		step(isLeftStepping, isRightStepping);
+
+		stepEvents--;
+	}
+
+	if (stepEvents == 0) {
+		// The block is done, release its slot.
+		current = NULL;
+		tail = (tail + 1) & (MOTORS_QUEUE_SIZE - 1);
+	}
+}
+
+void Motors::step(bool isLeftStepping, bool isRightStepping) {
+	if (PINS_SAME_PORT(MOTORS_LEFT_STEP, MOTORS_RIGHT_STEP)) {
+		// Both step pins are written at once.
+		byte mask = 0;
+		byte levels = 0;
+
+		if (isLeftStepping) {
+			mask |= PINS_MASK(MOTORS_LEFT_STEP);
+			if (leftLength % 2) {
+				levels |= PINS_MASK(MOTORS_LEFT_STEP);
+			}
+		}
+
+		if (isRightStepping) {
+			mask |= PINS_MASK(MOTORS_RIGHT_STEP);
+			if (rightLength % 2) {
+				levels |= PINS_MASK(MOTORS_RIGHT_STEP);
+			}
+		}
+
+		PINS_PORT(MOTORS_LEFT_STEP) = (PINS_PORT(MOTORS_LEFT_STEP) & (byte) ~mask) | levels;
+	} else {
+		if (isLeftStepping) {
+			PINS_WRITE(MOTORS_LEFT_STEP, leftLength % 2);
+		}
+
+		if (isRightStepping) {
+			PINS_WRITE(MOTORS_RIGHT_STEP, rightLength % 2);
+		}
+	}
+}
+
+bool Motors::setDirection(const Block &block) {
+	bool isChanged = false;
+
+	// The direction of a motor which does not move is kept.
+	if (block.leftSteps > 0 && block.pullLeft != isLeftPulling) {
+		PINS_WRITE(MOTORS_LEFT_DIR,
+				block.pullLeft ? PLT_LEFT_DIRECTION : !PLT_LEFT_DIRECTION);
+		isLeftPulling = block.pullLeft;
+		isChanged = true;
+	}
+
+	if (block.rightSteps > 0 && block.pullRight != isRightPulling) {
+		PINS_WRITE(MOTORS_RIGHT_DIR,
+				block.pullRight ? PLT_RIGHT_DIRECTION : !PLT_RIGHT_DIRECTION);
+		isRightPulling = block.pullRight;
+		isChanged = true;
+	}
+
+	return isChanged;
+}
@@ -0,0 +1,172 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Step generator header file.
+ */
+
+#ifndef _H_MOTORS
+#define _H_MOTORS
+
+#include "plotter.h"
+#include "profiler.h"
+#include <Arduino.h>
+
+/// Frequency of the step generator interrupt, in hertz.
+#define MOTORS_FREQUENCY 20000
+
+/// Number of slots in the blocks queue. Must be a power of 2.
+#define MOTORS_QUEUE_SIZE 4
+
+/// Fixed-point unit of the step rates: a rate of \a MOTORS_RATE_ONE is one step on each interrupt.
+#define MOTORS_RATE_ONE 0x1000000UL
+
+/**
+ * Step generator.
+ * The steps are emitted by the Timer2 compare-match interrupt, from a queue of blocks filled by the main
+ * loop. The main loop only has to parse and plan the drawing, while the interrupt keeps the motors moving.
+ * Timer1 is not used because it is owned by the Servo library.
+ */
+class Motors {
+
+public:
+
+	/**
+	 * A straight move of the two belts, as executed by the interrupt.
+	 * The motor which have the longer distance to travel steps on each step event, the other one is
+	 * interleaved with an integer DDA (Bresenham), so the two belts finish the block together.
+	 * The step event rate follows a trapezoidal profile: it ramps from \a entryRate up to \a nominalRate,
+	 * then down to \a exitRate.
+	 */
+	typedef struct {
+		unsigned long leftSteps;  ///< Number of steps to do on the left motor.
+		unsigned long rightSteps; ///< Number of steps to do on the right motor.
+		unsigned long stepCount;  ///< Number of step events, that is, the greatest of \a leftSteps and \a rightSteps.
+		unsigned long entryRate;  ///< Step events by interrupt at the beginning of the block, in MOTORS_RATE_ONE units.
+		unsigned long nominalRate;///< Step events by interrupt once accelerated, in MOTORS_RATE_ONE units.
+		unsigned long exitRate;   ///< Step events by interrupt at the end of the block, in MOTORS_RATE_ONE units.
+		unsigned long acceleration;    ///< Rate increase (or decrease) on each interrupt.
+		unsigned long accelerateSteps; ///< Number of step events during the acceleration.
+		unsigned long decelerateSteps; ///< Number of step events during the deceleration.
+		bool pullLeft;            ///< \a true to pull the left belt, \a false to release it.
+		bool pullRight;           ///< \a true to pull the right belt, \a false to release it.
+	} Block;
+
+	/**
+	 * Start the step generator interrupt.
+	 * \param leftLength The initial left belt length, in steps.
+	 * \param rightLength The initial right belt length, in steps.
+	 */
+	void start(unsigned long leftLength, unsigned long rightLength);
+
+	/**
+	 * Add a block at the end of the queue.
+	 * \param block The block to copy in the queue.
+	 * \return \a false if the queue is full, then the block is not added.
+	 */
+	bool push(const Block &block);
+
+	/**
+	 * Check if all the queued blocks have been executed.
+	 * \return \a true if the motors are stopped and the queue is empty.
+	 */
+	bool isIdle();
+
+	/**
+	 * Hold or release the queue: while it is held, the block being executed ends, but the next ones wait.
+	 * Used to keep the motors stopped while the pen moves, without blocking the main loop.
+	 * \param shouldHold \a true to hold the queue, \a false to release it.
+	 */
+	void hold(bool shouldHold);
+
+	/**
+	 * Get the left belt length, as currently executed by the motors.
+	 * \return The left belt length, in steps.
+	 */
+	unsigned long getLeftLength();
+
+	/**
+	 * Get the right belt length, as currently executed by the motors.
+	 * \return The right belt length, in steps.
+	 */
+	unsigned long getRightLength();
+
+	/**
+	 * Execute one interrupt period. Only called by the timer interrupt routine.
+	 */
+	void tick();
+
+private:
+
+	/// The blocks queue.
+	Block queue[MOTORS_QUEUE_SIZE];
+
+	/// Index of the next free slot in the queue, only written by the main loop.
+	volatile byte head;
+
+	/// Index of the block being executed, only written by the interrupt.
+	volatile byte tail;
+
+	/// \a true if the queued blocks must wait, see hold().
+	volatile bool isHeld;
+
+	/// The block being executed, or \a NULL if the motors are stopped.
+	Block *current;
+
+	/// Rate accumulator. A step event is done each time it reaches \a MOTORS_RATE_ONE.
+	unsigned long accumulator;
+
+	/// Current step events rate, in MOTORS_RATE_ONE units.
+	unsigned long rate;
+
+	/// Number of step events remaining in the current block.
+	unsigned long stepEvents;
+
+	/// Left DDA counter. The left motor steps each time it becomes positive.
+	long leftCounter;
+
+	/// Right DDA counter. The right motor steps each time it becomes positive.
+	long rightCounter;
+
+	/// Left belt length, in steps.
+	volatile unsigned long leftLength;
+
+	/// Right belt length, in steps.
+	volatile unsigned long rightLength;
+
+	/// Direction of the left motor, as set on its direction pin: \a true if it pulls the belt.
+	bool isLeftPulling;
+
+	/// Direction of the right motor, as set on its direction pin: \a true if it pulls the belt.
+	bool isRightPulling;
+
+	/**
+	 * Rotate the motors for one step, in the direction given by the direction pins.
+	 * The step pins are set to the parity of the belt lengths, which must be already updated.
+	 * \param isLeftStepping \a true if the left motor steps.
+	 * \param isRightStepping \a true if the right motor steps.
+	 */
+	void step(bool isLeftStepping, bool isRightStepping);
+
+	/**
+	 * Set the direction pins according to the block to execute. A pin is only written when the direction
+	 * of a moving motor changes.
+	 * \return \a true if a direction pin changed.
+	 */
+	bool setDirection(const Block &block);
+};
+
+/// The step generator instance, driven by the timer interrupt.
+extern Motors motors;
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Direct access to the output pins of the ATmega328P.
+ * The pins given to these macros must be constants: the port and the bit mask are then resolved at
+ * compile time, and an access compiles to a few instructions on the port register, instead of the pin
+ * lookup of digitalWrite(). The Arduino pins 0 to 7 are on port D, 8 to 13 on port B and A0 to A5 on
+ * port C. The analog only pins A6 and A7 can not be used: the pins above 19 fail the build (see
+ * PINS_CHECK()).
+ */
+
+#ifndef _H_PINS
+#define _H_PINS
+
+#include <Arduino.h>
+
+/// Fail the build if a pin is not one of the 20 digital pins, which would write another port or bit.
+#define PINS_CHECK(pin) static_assert((pin) >= 0 && (pin) <= 19, "pin " #pin " is not a digital pin (0 to 19)")
+
+/// Index of the port of a pin: 0 for port D, 1 for port B, 2 for port C.
+#define PINS_PORT_INDEX(pin) ((pin) < 8 ? 0 : (pin) < 14 ? 1 : 2)
+
+/// Output register of a pin.
+#define PINS_PORT(pin) ((pin) < 8 ? PORTD : (pin) < 14 ? PORTB : PORTC)
+
+/// Bit mask of a pin in its port registers.
+#define PINS_MASK(pin) _BV((pin) < 8 ? (pin) : (pin) < 14 ? (pin) - 8 : (pin) - 14)
+
+/// \a true if two pins are on the same port, so they can be written at once.
+#define PINS_SAME_PORT(pin1, pin2) (PINS_PORT_INDEX(pin1) == PINS_PORT_INDEX(pin2))
+
+/// Set the level of an output pin, like digitalWrite().
+#define PINS_WRITE(pin, level) do { \
+		PINS_CHECK(pin); \
+		if (level) { \
+			PINS_PORT(pin) |= PINS_MASK(pin); \
+		} else { \
+			PINS_PORT(pin) &= (byte) ~PINS_MASK(pin); \
+		} \
+	} while (0)
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Motion planner file.
+ */
+
+#include <planner.h>
+
+void Planner::start(unsigned long maxRate, unsigned long startRate,
+		unsigned long rateIncrease, float deviation) {
+	nominalRate = maxRate;
+	jerkRate = startRate < maxRate ? startRate : maxRate;
+	acceleration = rateIncrease;
+	junctionDeviation = deviation;
+	tail = 0;
+	count = 0;
+
+	// The motors would never start with a null rate.
+	if (jerkRate < acceleration) {
+		jerkRate = acceleration;
+	}
+}
+
+bool Planner::push(const Motors::Block &block, float dx, float dy) {
+	if (count == PLANNER_BUFFER_SIZE && !send()) {
+		return false;
+	}
+
+	float length = sqrt(dx * dx + dy * dy);
+	Move &move = at(count);
+
+	move.leftSteps = block.leftSteps;
+	move.rightSteps = block.rightSteps;
+	move.pullLeft = block.pullLeft;
+	move.pullRight = block.pullRight;
+
+	// Avoid division by zero, when the move is only a few steps long.
+	if (length < 0.001) {
+		length = 0.001;
+	}
+	move.factor = block.stepCount / length;
+
+	float unitX = dx / length;
+	float unitY = dy / length;
+
+	if (count == 0) {
+		// The motors are stopped or stopping.
+		move.maxEntrySpeed = jerkRate / move.factor;
+		move.entrySpeed = move.maxEntrySpeed;
+	} else {
+		move.maxEntrySpeed = getJunctionSpeed(move, unitX, unitY);
+	}
+
+	previousUnitX = unitX;
+	previousUnitY = unitY;
+	count++;
+
+	recalculate();
+
+	return true;
+}
+
+bool Planner::flush() {
+	while (count > 0) {
+		if (!send()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Planner::Move &Planner::at(byte index) {
+	return buffer[(tail + index) & (PLANNER_BUFFER_SIZE - 1)];
+}
+
+float Planner::getReachableSpeed2(const Move &move, float exitSpeed) {
+	// v0² = v1² + 2 * a * d, with a and d converted from step events to millimeters.
+	return exitSpeed * exitSpeed
+			+ 2.0 * MOTORS_RATE_ONE * acceleration
+					* (move.leftSteps > move.rightSteps ?
+							move.leftSteps : move.rightSteps)
+					/ (move.factor * move.factor);
+}
+
+float Planner::getJunctionSpeed(const Move &move, float unitX, float unitY) {
+	const Move &previous = at(count - 1);
+	float previousFactor = previous.factor;
+
+	// The speed is limited by the nominal and jerk rates of both moves.
+	float maxSpeed = nominalRate / max(move.factor, previousFactor);
+	float minSpeed = jerkRate / max(move.factor, previousFactor);
+
+	// Cosine of the angle between the previous move (reversed) and the new one.
+	float cosTheta = -(previousUnitX * unitX + previousUnitY * unitY);
+
+	if (cosTheta < -0.999999) {
+		// Straight junction
+		return maxSpeed;
+	} else if (cosTheta > 0.999999) {
+		// U-turn
+		return minSpeed;
+	}
+
+	// Speed on the arc tangent to both moves, whose distance to the junction is the junction deviation,
+	// with the lowest acceleration of both moves: v² = a * r, r = d * sin(θ/2) / (1 - sin(θ/2)).
+	float sinHalfTheta = sqrt(0.5 * (1.0 - cosTheta));
+	float speed = sqrt(
+			MOTORS_RATE_ONE * acceleration / max(move.factor, previousFactor)
+					* junctionDeviation * sinHalfTheta / (1.0 - sinHalfTheta));
+
+	if (speed > maxSpeed) {
+		return maxSpeed;
+	} else if (speed < minSpeed) {
+		return minSpeed;
+	}
+	return speed;
+}
+
+void Planner::recalculate() {
+	byte i;
+	float speed2;
+
+	// Backward pass: each move must be able to decelerate until the entry of the next one, and the
+	// last one until the stop.
+	float exitSpeed = jerkRate / at(count - 1).factor;
+	for (i = count - 1; i > 0; i--) {
+		Move &move = at(i);
+		speed2 = getReachableSpeed2(move, exitSpeed);
+		if (speed2 < move.maxEntrySpeed * move.maxEntrySpeed) {
+			move.entrySpeed = sqrt(speed2);
+		} else {
+			move.entrySpeed = move.maxEntrySpeed;
+		}
+		exitSpeed = move.entrySpeed;
+	}
+
+	// Forward pass: each move must be able to accelerate until the entry of the next one.
+	for (i = 0; i < count - 1; i++) {
+		Move &next = at(i + 1);
+		speed2 = getReachableSpeed2(at(i), at(i).entrySpeed);
+		if (speed2 < next.entrySpeed * next.entrySpeed) {
+			next.entrySpeed = sqrt(speed2);
+		}
+	}
+}
+
+bool Planner::send() {
+	Move &move = at(0);
+	Motors::Block block;
+
+	block.leftSteps = move.leftSteps;
+	block.rightSteps = move.rightSteps;
+	block.pullLeft = move.pullLeft;
+	block.pullRight = move.pullRight;
+	block.stepCount = max(move.leftSteps, move.rightSteps);
+	block.nominalRate = nominalRate;
+
+	block.entryRate = constrain(move.entrySpeed * move.factor, jerkRate,
+			nominalRate);
+	if (count > 1) {
+		block.exitRate = constrain(at(1).entrySpeed * move.factor, jerkRate,
+				nominalRate);
+	} else {
+		block.exitRate = jerkRate;
+	}
+
+	computeTrapezoid(block);
+
+	if (!motors.push(block)) {
+		return false;
+	}
+
+	tail = (tail + 1) & (PLANNER_BUFFER_SIZE - 1);
+	count--;
+
+	return true;
+}
+
+void Planner::computeTrapezoid(Motors::Block &block) {
+	if (acceleration == 0) {
+		block.entryRate = block.nominalRate;
+		block.exitRate = block.nominalRate;
+		block.acceleration = 0;
+		block.accelerateSteps = 0;
+		block.decelerateSteps = 0;
+		return;
+	}
+
+	// Number of step events to go from the rate v0 to the rate v1: (v1² - v0²) / (2 * a)
+	float doubleAcceleration = 2.0 * MOTORS_RATE_ONE * acceleration;
+	float nominal2 = (float) block.nominalRate * block.nominalRate;
+	float entry2 = (float) block.entryRate * block.entryRate;
+	float exit2 = (float) block.exitRate * block.exitRate;
+
+	float accelerateSteps = (nominal2 - entry2) / doubleAcceleration;
+	float decelerateSteps = (nominal2 - exit2) / doubleAcceleration;
+
+	if (accelerateSteps + decelerateSteps > block.stepCount) {
+		// The nominal rate can not be reached: accelerate until the deceleration must start.
+		accelerateSteps = (doubleAcceleration * block.stepCount + exit2 - entry2)
+				/ (2 * doubleAcceleration);
+		if (accelerateSteps < 0) {
+			accelerateSteps = 0;
+		} else if (accelerateSteps > block.stepCount) {
+			accelerateSteps = block.stepCount;
+		}
+		decelerateSteps = block.stepCount - accelerateSteps;
+	}
+
+	block.acceleration = acceleration;
+	block.accelerateSteps = accelerateSteps;
+	block.decelerateSteps = ceil(decelerateSteps);
+}
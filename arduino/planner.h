@@ -0,0 +1,147 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Motion planner header file.
+ */
+
+#ifndef _H_PLANNER
+#define _H_PLANNER
+
+#include "motors.h"
+#include <Arduino.h>
+
+/// Number of moves kept in the look-ahead buffer. Must be a power of 2.
+#define PLANNER_BUFFER_SIZE 8
+
+/**
+ * Motion planner.
+ * Compute the speed profile of each block before to send it to the step generator, in such a way as
+ * the motors never change their speed faster than the acceleration limit.
+ * The last moves are kept in a look-ahead buffer: the speed at each junction is limited according to the
+ * angle between the two moves, so the plotter can go through the curves without stopping on each point.
+ * The rates are expressed in step events by interrupt, in MOTORS_RATE_ONE units. The speeds, used to
+ * compare the moves on the sheet, are expressed in millimeters by interrupt, in MOTORS_RATE_ONE units.
+ */
+class Planner {
+
+public:
+
+	/**
+	 * Initialize the planner.
+	 * \param nominalRate The maximum step events rate.
+	 * \param jerkRate The step events rate the motors can reach or leave without acceleration.
+	 * \param acceleration The rate increase on each interrupt, or 0 to disable the acceleration.
+	 * \param junctionDeviation The distance between the junction of two moves and the arc the plotter
+	 * could follow at the junction speed, in mm. The greater it is, the faster the plotter goes in the curves.
+	 */
+	void start(unsigned long nominalRate, unsigned long jerkRate, unsigned long acceleration,
+			float junctionDeviation);
+
+	/**
+	 * Add a move in the look-ahead buffer.
+	 * When the buffer is full, the oldest move is planned and sent to the step generator.
+	 * \param block The block to plan, with its steps numbers and directions.
+	 * \param dx The horizontal move on the sheet, in mm.
+	 * \param dy The vertical move on the sheet, in mm.
+	 * \return \a false if the step generator queue is full, then the move is not added.
+	 */
+	bool push(const Motors::Block &block, float dx, float dy);
+
+	/**
+	 * Send all the buffered moves to the step generator, the last one stopping the motors.
+	 * \return \a false if the step generator queue is full, then some moves are still buffered.
+	 */
+	bool flush();
+
+private:
+
+	/**
+	 * A move waiting in the look-ahead buffer.
+	 */
+	typedef struct {
+		unsigned long leftSteps;  ///< Number of steps to do on the left motor.
+		unsigned long rightSteps; ///< Number of steps to do on the right motor.
+		bool pullLeft;            ///< \a true to pull the left belt, \a false to release it.
+		bool pullRight;           ///< \a true to pull the right belt, \a false to release it.
+		float factor;             ///< Number of step events by millimeter on the sheet.
+		float maxEntrySpeed;      ///< Maximum speed at the junction with the previous move.
+		float entrySpeed;         ///< Planned speed at the junction with the previous move.
+	} Move;
+
+	/// The look-ahead buffer.
+	Move buffer[PLANNER_BUFFER_SIZE];
+
+	/// Index of the oldest move in the buffer.
+	byte tail;
+
+	/// Number of moves in the buffer.
+	byte count;
+
+	/// Horizontal component of the unit vector of the last added move.
+	float previousUnitX;
+
+	/// Vertical component of the unit vector of the last added move.
+	float previousUnitY;
+
+	/// The maximum step events rate.
+	unsigned long nominalRate;
+
+	/// The step events rate used to start and stop the motors.
+	unsigned long jerkRate;
+
+	/// The rate increase on each interrupt.
+	unsigned long acceleration;
+
+	/// The junction deviation, in mm.
+	float junctionDeviation;
+
+	/**
+	 * Get a move of the buffer.
+	 * \param index The move position, from 0 for the oldest one.
+	 */
+	Move &at(byte index);
+
+	/**
+	 * Get the square of the maximum speed a move can start with, to reach a given speed at its end.
+	 * \param move The move.
+	 * \param exitSpeed The speed to reach at the end of the move.
+	 */
+	float getReachableSpeed2(const Move &move, float exitSpeed);
+
+	/**
+	 * Compute the maximum speed at the junction between the previous move and a new one.
+	 * \param move The new move, whose \a factor is set.
+	 * \param unitX Horizontal component of the new move unit vector.
+	 * \param unitY Vertical component of the new move unit vector.
+	 */
+	float getJunctionSpeed(const Move &move, float unitX, float unitY);
+
+	/**
+	 * Update the entry speeds of all the buffered moves, except the oldest one whose entry is already sent.
+	 */
+	void recalculate();
+
+	/**
+	 * Plan the oldest move and send it to the step generator.
+	 * \return \a false if the step generator queue is full.
+	 */
+	bool send();
+
+	/**
+	 * Compute the acceleration and deceleration lengths of a block, according to its entry and exit rates.
+	 */
+	void computeTrapezoid(Motors::Block &block);
+};
+
+#endif
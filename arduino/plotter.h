@@ -48,6 +48,40 @@
 /// Serial speed, in bauds.
 #define SERIAL_BAUDS 57600
 
+/// Send one byte on each motor step (as used by the desktop viewer) instead of periodic step reports,
+/// with 0 = disabled and 1 = enabled.
+#define EN_STEP_BYTES 0
+
+/// Minimum delay between two step reports, in milliseconds.
+#define SERIAL_REPORT_PERIOD 50
+
+/// Send and receive the serial data in frames with a CRC and a sequence number (see frame.h and
+/// seriallink.h), at SERIAL_FRAMES_BAUDS, with 0 = disabled and 1 = enabled. When disabled, the legacy one
+/// byte codes are sent as is at SERIAL_BAUDS. It uses about 140 bytes of RAM.
+#define EN_SERIAL_FRAMES 1
+
+/// Serial speed with EN_SERIAL_FRAMES, in bauds. It is exact with a 16 MHz clock.
+#define SERIAL_FRAMES_BAUDS 500000
+
+/// Delay between two state snapshots with EN_SERIAL_FRAMES, in milliseconds, instead of the step reports.
+/// They are sent by batches of FRAME_MAX_PAYLOAD / FRAME_STATE_SIZE, or once the motors are stopped.
+#define SERIAL_FRAMES_REPORT_PERIOD 10
+
+/// Enable the profiling counters, sent through serial link at the end of the drawing (see profiler.h),
+/// with 0 = disabled and 1 = enabled.
+#define EN_PROFILING 0
+
+/// Latency from which a step interrupt is counted as late, in microseconds.
+#define PROFILING_LATE_DELAY 10
+
+/// Compute the belt lengths with 32 bits integers instead of float (see kinematics.h), with 0 = disabled
+/// and 1 = enabled.
+#define EN_INTEGER_KINEMATICS 0
+
+/// Enable the belt lengths grid, which replaces the square roots of the kinematics by interpolations (see
+/// kinematics.h), with 0 = disabled and 1 = enabled. It uses about 600 bytes of RAM.
+#define EN_LENGTH_TABLE 0
+
 // *** Pins allocation ***
 
 /// Pause button interruption pin.
@@ -132,9 +166,3 @@
 
 /// Maximum servo-motor angle (as far away as possible to the wall).
 #define PLT_MAX_SERVO_ANGLE 95
-
-/// Delay before the servo moves, in milliseconds.
-#define PLT_PRE_SERVO_DELAY 750
-
-/// Delay after the servo moves, in milliseconds.
-#define PLT_POST_SERVO_DELAY 750
@@ -0,0 +1,124 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Profiling counters of the plotter, enabled with EN_PROFILING.
+ */
+
+#include <profiler.h>
+
+#if EN_PROFILING && !defined(PROFILE_HOST)
+
+#include "seriallink.h"
+
+/**
+ * Counters of a profiled section. The times include the nested sections, with the 4 µs resolution of micros().
+ */
+typedef struct {
+	unsigned long calls;     ///< Number of calls.
+	unsigned long totalTime; ///< Total time spent in the section, in µs.
+	unsigned long maxTime;   ///< Longest call, in µs.
+	unsigned long startTime; ///< Beginning of the current call, in µs.
+} Section;
+
+static Section sections[PROFILE_NB_SECTIONS];
+
+/// Number of step interrupts whose latency is greater than PROFILING_LATE_DELAY.
+static volatile unsigned long lateSteps = 0;
+
+/// Number of step interrupts still running when the next one is due.
+static volatile unsigned long overruns = 0;
+
+/// Longest interrupt latency, in timer counts.
+static volatile byte maxLatency = 0;
+
+/// Longest time between two main loop iterations while the motors run, in µs.
+static unsigned long maxLoopLatency = 0;
+
+/// Time of the last main loop iteration while the motors run, in µs, or 0 if they are stopped.
+static unsigned long lastLoopTime = 0;
+
+void profileEnter(unsigned char section) {
+	sections[section].startTime = micros();
+}
+
+void profileExit(unsigned char section) {
+	Section &s = sections[section];
+	unsigned long duration = micros() - s.startTime;
+
+	s.calls++;
+	s.totalTime += duration;
+	if (duration > s.maxTime) {
+		s.maxTime = duration;
+	}
+}
+
+void profileInterrupt(unsigned char latency, bool isOverrun) {
+	// The timer counts by 8 CPU cycles.
+	if (latency > PROFILING_LATE_DELAY * (F_CPU / 8 / 1000000)) {
+		lateSteps++;
+	}
+	if (latency > maxLatency) {
+		maxLatency = latency;
+	}
+	if (isOverrun) {
+		overruns++;
+	}
+}
+
+void profileLoop(bool isMoving) {
+	unsigned long now = micros();
+
+	if (isMoving && lastLoopTime != 0 && now - lastLoopTime > maxLoopLatency) {
+		maxLoopLatency = now - lastLoopTime;
+	}
+	lastLoopTime = isMoving ? now : 0;
+}
+
+void profileReport() {
+#if EN_SERIAL
+	const char *names[PROFILE_NB_SECTIONS] = { "parsing", "kinematics", "stepping", "waiting",
+			"segment", "pen" };
+	byte i;
+
+	noInterrupts();
+	unsigned long late = lateSteps;
+	unsigned long missed = overruns;
+	byte latency = maxLatency;
+	interrupts();
+
+	// One "name=calls,total µs,max µs" line by section, then the interrupts and loop counters.
+	for (i = 0; i < PROFILE_NB_SECTIONS; i++) {
+		if (sections[i].calls == 0) {
+			continue;
+		}
+		serialLink.print(names[i]);
+		serialLink.print("=");
+		serialLink.print(sections[i].calls);
+		serialLink.print(",");
+		serialLink.print(sections[i].totalTime);
+		serialLink.print(",");
+		serialLink.println(sections[i].maxTime);
+	}
+	serialLink.print("lateSteps=");
+	serialLink.println(late);
+	serialLink.print("overruns=");
+	serialLink.println(missed);
+	serialLink.print("maxLatency=");
+	serialLink.println(latency / (F_CPU / 8 / 1000000));
+	serialLink.print("maxLoopLatency=");
+	serialLink.println(maxLoopLatency);
+#endif
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Profiling hooks, placed around the main parts of the code.
+ * They compile to nothing, except:
+ * - in the host simulator (PROFILE_HOST defined), which measures the time spent in each section, and the
+ * distance between the pen and the queued segments;
+ * - on the plotter with EN_PROFILING, which counts the time spent in each section, the late step
+ * interrupts and the main loop latency, then sends a summary through serial link at the end of the drawing.
+ */
+
+#ifndef _H_PROFILER
+#define _H_PROFILER
+
+#include "plotter.h"
+
+/// Profiled sections.
+enum {
+	PROFILE_PARSING,    ///< Reading and decoding each line or record of the drawing, with the moves planning.
+	PROFILE_KINEMATICS, ///< Computing the belt lengths.
+	PROFILE_STEPPING,   ///< Generating the steps, in the interrupt.
+	PROFILE_WAITING,    ///< Waiting for the motors, when their queue is full or before a pen move.
+	PROFILE_SEGMENT,    ///< Converting a segment to motor steps.
+	PROFILE_PEN,        ///< Moving the pen.
+	PROFILE_NB_SECTIONS
+};
+
+#if defined(PROFILE_HOST) || EN_PROFILING
+
+void profileEnter(unsigned char section);
+void profileExit(unsigned char section);
+
+/// Start to count the time spent in a section, until the matching PROFILE_EXIT().
+#define PROFILE_ENTER(section) profileEnter(section)
+
+/// Stop to count the time spent in a section.
+#define PROFILE_EXIT(section) profileExit(section)
+
+#else
+
+#define PROFILE_ENTER(section)
+#define PROFILE_EXIT(section)
+
+#endif
+
+#ifdef PROFILE_HOST
+
+/**
+ * Give the simulator a segment queued to the motors, from [\a startX ; \a startY] to [\a endX ; \a endY] on the
+ * sheet, in mm from its lower left corner, and ending at the belt lengths \a leftLength and \a rightLength,
+ * in steps. The simulator measures how far the pen goes from it.
+ */
+void profileSegment(float startX, float startY, float endX, float endY, long leftLength, long rightLength);
+
+/// Give a queued segment to the simulator.
+#define PROFILE_QUEUED_SEGMENT(startX, startY, endX, endY, leftLength, rightLength) \
+	profileSegment(startX, startY, endX, endY, leftLength, rightLength)
+
+#else
+
+#define PROFILE_QUEUED_SEGMENT(startX, startY, endX, endY, leftLength, rightLength)
+
+#endif
+
+#if EN_PROFILING && !defined(PROFILE_HOST)
+
+/// Count a step interrupt, with its latency in timer counts, and \a true if the next one is already due.
+void profileInterrupt(unsigned char latency, bool isOverrun);
+void profileLoop(bool isMoving);
+
+/// Send the profiling summary through serial link.
+void profileReport();
+
+/// Mark an iteration of the main loop, to measure the longest time between two of them while the motors run.
+#define PROFILE_LOOP(isMoving) profileLoop(isMoving)
+
+#else
+
+#define PROFILE_LOOP(isMoving)
+
+#endif
+
+#endif
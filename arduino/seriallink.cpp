@@ -0,0 +1,186 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Serial link file.
+ */
+
+#include <seriallink.h>
+
+SerialLink serialLink;
+
+#if EN_SERIAL_FRAMES
+
+void SerialLink::begin() {
+	Serial.begin(SERIAL_FRAMES_BAUDS);
+
+	data.begin(FRAME_DATA);
+	states.begin(FRAME_STATE);
+	sentSeq = 0;
+	expectedSeq = 0;
+	isRejected = false;
+	nbRead = 0;
+	isWaiting = false;
+	gcodeIndex = 0;
+	gcodeLength = 0;
+}
+
+size_t SerialLink::write(uint8_t value) {
+	if (!data.add(value)) {
+		send(data, FRAME_DATA);
+		data.add(value);
+	}
+	return 1;
+}
+
+bool SerialLink::available() {
+	while (gcodeIndex == gcodeLength) {
+		FrameStatus status = decoder.next();
+		if (status == FRAME_INCOMPLETE) {
+			if (!Serial.available()) {
+				return false;
+			}
+			status = decoder.push(Serial.read());
+			nbRead++;
+			isWaiting = false;
+		}
+
+		if (status == FRAME_COMPLETE) {
+			receive();
+		} else if (status == FRAME_CORRUPTED) {
+			reject();
+		}
+	}
+
+	return true;
+}
+
+int SerialLink::read() {
+	if (available()) {
+		return gcode[gcodeIndex++];
+	}
+
+	// The last frame may have been lost, while the computer waits for its acknowledgment.
+	if (!isWaiting) {
+		isWaiting = true;
+		waitStartTime = millis();
+	} else if (millis() - waitStartTime > SERIAL_LINK_TIMEOUT) {
+		isRejected = false;
+		reject();
+		waitStartTime = millis();
+	}
+	return -1;
+}
+
+bool SerialLink::addState(int leftDelta, int rightDelta, bool isWriting) {
+	if (states.getLength() + FRAME_STATE_SIZE > FRAME_MAX_PAYLOAD) {
+		return false;
+	}
+
+	states.add(leftDelta & 0xFF);
+	states.add(leftDelta >> 8);
+	states.add(rightDelta & 0xFF);
+	states.add(rightDelta >> 8);
+	states.add(isWriting);
+	return true;
+}
+
+bool SerialLink::update(bool shouldSendStates) {
+	if (data.getLength() > 0
+			&& Serial.availableForWrite() >= data.getLength() + FRAME_OVERHEAD) {
+		send(data, FRAME_DATA);
+	}
+
+	bool isStatesFull = states.getLength() + FRAME_STATE_SIZE > FRAME_MAX_PAYLOAD;
+	if (states.getLength() > 0 && (shouldSendStates || isStatesFull)
+			&& Serial.availableForWrite() >= states.getLength() + FRAME_OVERHEAD) {
+		send(states, FRAME_STATE);
+	}
+
+	return data.getLength() == 0 && states.getLength() == 0;
+}
+
+void SerialLink::flush() {
+	while (!update(true))
+		;
+}
+
+void SerialLink::send(FrameEncoder &encoder, FrameType type) {
+	uint8_t size = encoder.end(sentSeq++);
+	const uint8_t *frame = encoder.getFrame();
+
+	for (uint8_t i = 0; i < size; i++) {
+		Serial.write(frame[i]);
+	}
+	encoder.begin(type);
+}
+
+void SerialLink::sendControl(FrameType type, uint8_t seq) {
+	FrameEncoder control;
+	control.begin(type);
+	control.add(seq);
+	control.add(nbRead & 0xFF);
+	control.add(nbRead >> 8);
+	send(control, type);
+}
+
+void SerialLink::receive() {
+	if (decoder.getType() != FRAME_GCODE) {
+		return;
+	}
+
+	uint8_t seq = decoder.getSeq();
+	if (seq == expectedSeq) {
+		memcpy(gcode, decoder.getPayload(), decoder.getLength());
+		gcodeIndex = 0;
+		gcodeLength = decoder.getLength();
+
+		// The frame has left the receive buffer: the computer can send the next ones.
+		sendControl(FRAME_ACK, seq);
+		expectedSeq++;
+		isRejected = false;
+	} else if ((uint8_t) (expectedSeq - seq) <= 128) {
+		// Sent again while its acknowledgment was on the way
+		sendControl(FRAME_ACK, seq);
+	} else {
+		// A previous frame has been lost.
+		reject();
+	}
+}
+
+void SerialLink::reject() {
+	if (!isRejected) {
+		sendControl(FRAME_NACK, expectedSeq);
+		isRejected = true;
+	}
+}
+
+#else
+
+void SerialLink::begin() {
+	Serial.begin(SERIAL_BAUDS);
+}
+
+size_t SerialLink::write(uint8_t value) {
+	return Serial.write(value);
+}
+
+bool SerialLink::available() {
+	return Serial.available() > 0;
+}
+
+int SerialLink::read() {
+	return Serial.read();
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Serial link header file.
+ */
+
+#ifndef _H_SERIAL_LINK
+#define _H_SERIAL_LINK
+
+#include "plotter.h"
+#include "frame.h"
+#include <Arduino.h>
+
+/// Delay after which the plotter, waiting for a frame, asks for it again, in milliseconds.
+#define SERIAL_LINK_TIMEOUT 50
+
+/**
+ * Serial link with the computer, used by the plotter instead of Serial.
+ * Without EN_SERIAL_FRAMES, the bytes are written and read as is on Serial. With it, the written bytes
+ * are sent in FRAME_DATA frames, the state snapshots in FRAME_STATE frames, and the streamed drawing is
+ * read from FRAME_GCODE frames, each one acknowledged as soon as it leaves the receive buffer. A frame
+ * which is corrupted or out of sequence is answered by a FRAME_NACK, once until the expected frame comes,
+ * and again if nothing comes in SERIAL_LINK_TIMEOUT. The acknowledgments count the bytes read, dropped ones
+ * included, so the computer never overflows the receive buffer.
+ * The frames are sent by update(), only when they fit in the transmit buffer, so it never blocks.
+ */
+class SerialLink : public Print {
+
+public:
+
+	/**
+	 * Start the serial port, at SERIAL_BAUDS or SERIAL_FRAMES_BAUDS.
+	 */
+	void begin();
+
+	/**
+	 * Write a byte, sent by the next update() with EN_SERIAL_FRAMES.
+	 */
+	size_t write(uint8_t value);
+
+	/**
+	 * Check if a char of the streamed drawing has been received.
+	 */
+	bool available();
+
+	/**
+	 * Read a char of the streamed drawing.
+	 * \return The char, or -1 if none has been received yet.
+	 */
+	int read();
+
+#if EN_SERIAL_FRAMES
+	/**
+	 * Add a state snapshot to the next FRAME_STATE frame.
+	 * \param leftDelta The left belt steps since the previous snapshot.
+	 * \param rightDelta The right belt steps since the previous snapshot.
+	 * \param isWriting \a true if the pen is writing.
+	 * \return \a false if the frame is full, then the snapshot is not added.
+	 */
+	bool addState(int leftDelta, int rightDelta, bool isWriting);
+
+	/**
+	 * Send the pending frames which fit in the transmit buffer.
+	 * \param shouldSendStates \a true to send the state snapshots before their frame is full.
+	 * \return \a true if all the frames have been sent.
+	 */
+	bool update(bool shouldSendStates);
+
+	/**
+	 * Send all the pending frames, waiting for room in the transmit buffer.
+	 */
+	void flush();
+#endif
+
+private:
+
+#if EN_SERIAL_FRAMES
+	/**
+	 * Send a frame, then start a new one.
+	 * \param type The type of the new frame.
+	 */
+	void send(FrameEncoder &encoder, FrameType type);
+
+	/**
+	 * Send a FRAME_ACK or a FRAME_NACK.
+	 */
+	void sendControl(FrameType type, uint8_t seq);
+
+	/**
+	 * Handle a received frame.
+	 */
+	void receive();
+
+	/**
+	 * Ask the computer to send the frames again from the expected one, once.
+	 */
+	void reject();
+
+	/// The FRAME_DATA frame being filled.
+	FrameEncoder data;
+
+	/// The FRAME_STATE frame being filled.
+	FrameEncoder states;
+
+	FrameDecoder decoder;
+
+	/// Sequence number of the next sent frame.
+	uint8_t sentSeq;
+
+	/// Sequence number of the next FRAME_GCODE frame to read.
+	uint8_t expectedSeq;
+
+	/// \a true if a FRAME_NACK has been sent for \a expectedSeq.
+	bool isRejected;
+
+	/// Number of bytes read on Serial, sent back in FRAME_ACK and FRAME_NACK.
+	uint16_t nbRead;
+
+	/// \a true if read() has nothing to return since \a waitStartTime.
+	bool isWaiting;
+
+	/// Time when read() started to wait for a frame, in milliseconds.
+	unsigned long waitStartTime;
+
+	/// Payload of the FRAME_GCODE frame being read, copied from the decoder.
+	char gcode[FRAME_MAX_PAYLOAD];
+
+	/// Position of the next char to read in \a gcode.
+	byte gcodeIndex;
+
+	/// Number of chars in \a gcode.
+	byte gcodeLength;
+#endif
+};
+
+extern SerialLink serialLink;
+
+#endif
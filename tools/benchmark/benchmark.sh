@@ -0,0 +1,109 @@
+#!/bin/sh
+#
+# This file is part of DraWall.
+# DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+# General Public License as published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+# DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+# the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details. You should have received a copy of the GNU
+# General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+# © 2012–2014 Nathanaël Jourdane
+# © 2014 Victor Adam
+#
+# Run the plotter simulator on the SD card drawing and on the stress drawings, then write their
+# statistics (see writeStats() in tools/simulator/simulator.cpp) in a CSV file, one line by drawing. The
+# binary SD card drawing is also run with the integer kinematics (EN_INTEGER_KINEMATICS, see kinematics.h).
+# The splitting of the drawn lines into segments according to their deviation (see Drawall::drawLine()) is
+# compared with the former splitting in pieces of SEGMENT_FIXED_LENGTH drawing units, on the GCode drawings,
+# in a second CSV file named as the first one with a -segmentation suffix.
+# Usage: benchmark.sh [results file], by default benchmark.csv in the current directory.
+
+set -e
+
+RESULTS=$(realpath "${1:-benchmark.csv}")
+SEGMENTATION=${RESULTS%.csv}-segmentation.csv
+TOOLS=$(dirname "$(realpath "$0")")/..
+ARDUINO=$TOOLS/../arduino
+WORK=$(mktemp -d)
+SEGMENT_FIXED_LENGTH=5
+trap 'rm -rf "$WORK"' EXIT
+
+# Build the simulator with the plotter library of a directory
+build() {
+	g++ -O2 -DPROFILE_HOST -I "$TOOLS/simulator/mocks" -I "$2" -o "$WORK/$1" \
+			"$TOOLS/simulator/simulator.cpp" "$2/drawall.cpp" "$2/frame.cpp" "$2/kinematics.cpp" \
+			"$2/motors.cpp" "$2/planner.cpp" "$2/profiler.cpp" "$2/seriallink.cpp"
+}
+
+build simulator "$ARDUINO"
+cp -r "$ARDUINO" "$WORK/integer"
+sed -i 's/^#define EN_INTEGER_KINEMATICS .*/#define EN_INTEGER_KINEMATICS 1/' "$WORK/integer/plotter.h"
+build simulatorInteger "$WORK/integer"
+cp -r "$ARDUINO" "$WORK/fixed"
+sed -i "s|^\tint nbSegments = ceil(sqrt(.*|\tint nbSegments = ceil(max(fabs(x - plotterPosX), fabs(y - plotterPosY)) / $SEGMENT_FIXED_LENGTH);|" \
+		"$WORK/fixed/drawall.cpp"
+grep -q "/ $SEGMENT_FIXED_LENGTH);" "$WORK/fixed/drawall.cpp" || { echo "drawLine() splitting not found" >&2; exit 1; }
+build simulatorFixed "$WORK/fixed"
+g++ -O2 -o "$WORK/stress" "$TOOLS/benchmark/stress.cpp"
+g++ -O2 -o "$WORK/gcode2bin" "$TOOLS/gcode2bin.cpp"
+
+# Each drawing gets its own SD card directory, with the default config file
+prepare() {
+	mkdir "$WORK/$1"
+	cp "$TOOLS/../SD_files/config" "$WORK/$1/config"
+}
+
+prepare drawing
+cp "$TOOLS/../SD_files/drawing" "$WORK/drawing/drawing"
+prepare drawingBinary
+"$WORK/gcode2bin" "$WORK/drawing/drawing" "$WORK/drawingBinary/drawing" > /dev/null
+for STRESS in spiral lines lifts; do
+	prepare $STRESS
+	"$WORK/stress" $STRESS > "$WORK/$STRESS/drawing"
+done
+
+# Same drawing without the lines simplification, to compare the segments number and the plot time
+prepare drawingBinaryUnsimplified
+cp "$WORK/drawingBinary/drawing" "$WORK/drawingBinaryUnsimplified/drawing"
+sed -i 's/^simplifyTolerance=.*/simplifyTolerance=0/' "$WORK/drawingBinaryUnsimplified/config"
+
+prepare drawingBinaryInteger
+cp "$WORK/drawingBinary/drawing" "$WORK/drawingBinaryInteger/drawing"
+
+HEADER=
+for DRAWING in drawing drawingBinary drawingBinaryUnsimplified drawingBinaryInteger spiral lines lifts; do
+	SIMULATOR=simulator
+	if [ $DRAWING = drawingBinaryInteger ]; then
+		SIMULATOR=simulatorInteger
+	fi
+	"$WORK/$SIMULATOR" --no-trace "$WORK/$DRAWING" "$WORK/$DRAWING/result" > /dev/null
+	if [ -z "$HEADER" ]; then
+		HEADER="drawing,$(cut -d= -f1 "$WORK/$DRAWING/result.stats" | paste -sd, -)"
+		echo "$HEADER" > "$RESULTS"
+	fi
+	echo "$DRAWING,$(cut -d= -f2 "$WORK/$DRAWING/result.stats" | paste -sd, -)" >> "$RESULTS"
+done
+
+cat "$RESULTS"
+
+# The segments of the moves are the same for both splittings.
+SEGMENTATION_KEYS="segmentCalls kinematicsCalls maxDeviation meanDeviation plotTime"
+echo "drawing,splitting,$(echo $SEGMENTATION_KEYS | tr ' ' ,)" > "$SEGMENTATION"
+for DRAWING in drawing spiral lines lifts; do
+	"$WORK/simulatorFixed" --no-trace "$WORK/$DRAWING" "$WORK/$DRAWING/fixed" > /dev/null
+	for SPLITTING in fixed deviation; do
+		STATS="$WORK/$DRAWING/result.stats"
+		if [ $SPLITTING = fixed ]; then
+			STATS="$WORK/$DRAWING/fixed.stats"
+		fi
+		LINE="$DRAWING,$SPLITTING"
+		for KEY in $SEGMENTATION_KEYS; do
+			LINE="$LINE,$(sed -n "s/^$KEY=//p" "$STATS")"
+		done
+		echo "$LINE" >> "$SEGMENTATION"
+	done
+done
+
+echo
+cat "$SEGMENTATION"
@@ -0,0 +1,81 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Generate synthetic GCode drawings stressing one part of the plotter.
+ * Build: g++ -O2 -o stress stress.cpp
+ * Usage: stress <spiral|lines|lifts> > drawing
+ * - spiral: a dense spiral made of many short lines, to stress the parsing and the planner;
+ * - lines: long straight lines, to stress the step generation at full speed;
+ * - lifts: many short dashes, to stress the pen lifts.
+ * The drawings fit in a square of STRESS_SIZE drawing units.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/// Size of the drawings, in drawing units.
+#define STRESS_SIZE 15000
+
+static void spiral() {
+	float center = STRESS_SIZE / 2.0;
+	int turns = 40;
+	float step = 0.05; // angle between two points, in radians
+
+	printf("G00 X%.3f Y%.3f\n", center, center);
+	for (float angle = step; angle < turns * 2 * M_PI; angle += step) {
+		float radius = center * angle / (turns * 2 * M_PI);
+		printf("G01 X%.3f Y%.3f\n", center + radius * cos(angle), center + radius * sin(angle));
+	}
+}
+
+static void lines() {
+	int nbLines = 50;
+
+	printf("G00 X0 Y0\n");
+	for (int i = 0; i < nbLines; i++) {
+		printf("G01 X%d Y%d\n", i % 2 ? 0 : STRESS_SIZE, i * STRESS_SIZE / nbLines);
+		printf("G01 X%d Y%d\n", i % 2 ? 0 : STRESS_SIZE, (i + 1) * STRESS_SIZE / nbLines);
+	}
+}
+
+static void lifts() {
+	int nbColumns = 10;
+	int nbRows = 40;
+	int length = 100;
+
+	for (int row = 0; row < nbRows; row++) {
+		for (int column = 0; column < nbColumns; column++) {
+			int x = column * STRESS_SIZE / nbColumns;
+			int y = row * STRESS_SIZE / nbRows;
+			printf("G00 X%d Y%d\n", x, y);
+			printf("G01 X%d Y%d\n", x + length, y);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 2 && !strcmp(argv[1], "spiral")) {
+		spiral();
+	} else if (argc == 2 && !strcmp(argv[1], "lines")) {
+		lines();
+	} else if (argc == 2 && !strcmp(argv[1], "lifts")) {
+		lifts();
+	} else {
+		fprintf(stderr, "Usage: %s <spiral|lines|lifts>\n", argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
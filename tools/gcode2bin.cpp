@@ -0,0 +1,212 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Compile a GCode drawing into a binary drawing file (see arduino/drawing.h), to copy on the SD card.
+ * Build: g++ -O2 -o gcode2bin gcode2bin.cpp
+ * Usage: gcode2bin <input GCode file> <output binary file>
+ * The understood GCode functions are the ones of the plotter: G00, G01 (raising the pen if Z is positive)
+ * and G04. The drawing is moved so its smallest coordinates are 0, as the plotter fits the drawing from
+ * 0 to its bounds on the sheet: the bounds are then its width and height.
+ */
+
+#include "../arduino/drawing.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+/// Maximum length of a GCode line.
+#define LINE_MAX_LENGTH 256
+
+/**
+ * Append a little endian integer to the output.
+ * \param out The output bytes.
+ * \param value The integer to append.
+ * \param size The integer size, in bytes.
+ */
+static void writeInteger(std::vector<unsigned char> &out, long value, int size) {
+	for (int i = 0; i < size; i++) {
+		out.push_back((value >> (8 * i)) & 0xFF);
+	}
+}
+
+/**
+ * Read a 4 bytes little endian integer of the output.
+ * \param out The output bytes.
+ * \param offset The position of the integer in the output.
+ * \return The integer.
+ */
+static long readInteger(const std::vector<unsigned char> &out, size_t offset) {
+	return (int32_t) (out[offset] | out[offset + 1] << 8 | out[offset + 2] << 16
+			| (uint32_t) out[offset + 3] << 24);
+}
+
+/**
+ * Convert a GCode number to thousandths.
+ */
+static long toFixed(const char *text) {
+	return lround(strtod(text, NULL) * 1000);
+}
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input GCode file> <output binary file>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *input = fopen(argv[1], "r");
+	if (!input) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	std::vector<unsigned char> records;
+	char line[LINE_MAX_LENGTH];
+	long posX = 0, posY = 0;
+	long minX = 0, minY = 0, maxX = 0, maxY = 0;
+	std::vector<size_t> pointOffsets; // positions of the absolute points in the records, moved at the end
+	bool isPenDown = false;
+	bool hasPoint = false;
+	long nbLines = 0, nbPoints = 0, nbUnknown = 0;
+
+	while (fgets(line, sizeof(line), input)) {
+		nbLines++;
+
+		char *function = strtok(line, " \t\r\n");
+		if (!function || function[0] == '#' || function[0] == ';' || function[0] == '(') {
+			continue;
+		}
+
+		long x = posX, y = posY, z = 0, p = 0;
+		bool hasX = false;
+		char *word;
+
+		while ((word = strtok(NULL, " \t\r\n"))) {
+			switch (word[0]) {
+			case 'X':
+				x = toFixed(word + 1);
+				hasX = true;
+				break;
+			case 'Y':
+				y = toFixed(word + 1);
+				break;
+			case 'Z':
+				z = toFixed(word + 1);
+				break;
+			case 'P':
+				p = toFixed(word + 1);
+				break;
+			}
+		}
+
+		bool shouldWrite;
+		if (!strcmp(function, "G00")) {
+			shouldWrite = false;
+		} else if (!strcmp(function, "G01")) {
+			shouldWrite = z <= 0;
+		} else if (!strcmp(function, "G04")) {
+			records.push_back(DWB_WAIT);
+			// As Drawall::processSDLine(), in thousandths of second: P, else X, else no wait
+			long delay = p > 0 ? p : hasX ? x : 0;
+			writeInteger(records, delay > 0xFFFF ? 0xFFFF : delay, 2);
+			continue;
+		} else {
+			if (strcmp(function, "G21") && strcmp(function, "M30")) {
+				nbUnknown++;
+			}
+			continue;
+		}
+
+		// The plotter lowers the pen on the next point: a pen lowered without moving draws a dot on a zero delta.
+		bool isDot = shouldWrite && !isPenDown;
+		if (shouldWrite != isPenDown) {
+			records.push_back(shouldWrite ? DWB_PEN_DOWN : DWB_PEN_UP);
+			isPenDown = shouldWrite;
+		}
+
+		if (hasPoint && x == posX && y == posY && !isDot) {
+			continue; // only the pen changes
+		}
+
+		long dx = x - posX;
+		long dy = y - posY;
+		if (hasPoint && dx >= -32768 && dx <= 32767 && dy >= -32768 && dy <= 32767) {
+			records.push_back(DWB_DELTA);
+			writeInteger(records, dx, 2);
+			writeInteger(records, dy, 2);
+		} else {
+			records.push_back(DWB_POINT);
+			pointOffsets.push_back(records.size());
+			writeInteger(records, x, 4);
+			writeInteger(records, y, 4);
+		}
+
+		posX = x;
+		posY = y;
+		hasPoint = true;
+		nbPoints++;
+
+		if (nbPoints == 1 || x < minX) {
+			minX = x;
+		}
+		if (nbPoints == 1 || y < minY) {
+			minY = y;
+		}
+		if (nbPoints == 1 || x > maxX) {
+			maxX = x;
+		}
+		if (nbPoints == 1 || y > maxY) {
+			maxY = y;
+		}
+	}
+	records.push_back(DWB_END);
+
+	// The deltas are kept: only the absolute points are moved.
+	for (size_t i = 0; i < pointOffsets.size(); i++) {
+		std::vector<unsigned char> point;
+		writeInteger(point, readInteger(records, pointOffsets[i]) - minX, 4);
+		writeInteger(point, readInteger(records, pointOffsets[i] + 4) - minY, 4);
+		std::copy(point.begin(), point.end(), records.begin() + pointOffsets[i]);
+	}
+	long width = maxX - minX;
+	long height = maxY - minY;
+
+	long inputSize = ftell(input);
+	fclose(input);
+
+	FILE *output = fopen(argv[2], "wb");
+	if (!output) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	std::vector<unsigned char> header(DWB_MAGIC, DWB_MAGIC + DWB_MAGIC_LENGTH);
+	writeInteger(header, width, 4);
+	writeInteger(header, height, 4);
+
+	fwrite(&header[0], 1, header.size(), output);
+	fwrite(&records[0], 1, records.size(), output);
+	fclose(output);
+
+	printf("%ld lines, %ld points, %ld unknown functions\n", nbLines, nbPoints, nbUnknown);
+	printf("bounds: %.3f x %.3f, moved by %.3f, %.3f\n", width / 1000.0, height / 1000.0, -minX / 1000.0,
+			-minY / 1000.0);
+	printf("size: %ld bytes -> %lu bytes\n", inputSize,
+			(unsigned long) (header.size() + records.size()));
+
+	return 0;
+}
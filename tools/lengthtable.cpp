@@ -0,0 +1,187 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Measure the error of the belt lengths grid (EN_LENGTH_TABLE, see arduino/kinematics.h) on a plotter
+ * configuration, against the belt lengths computed with a square root.
+ * Build, from this directory:
+ * g++ -O2 -I simulator/mocks -I ../arduino -o lengthtable lengthtable.cpp ../arduino/kinematics.cpp
+ * Usage: lengthtable <config file>
+ * The grid is built like the plotter does at startup, then the two belts lengths are compared on each
+ * point of the sheet, every SAMPLE_STEP micrometers. The time of a length on the computer is printed for the
+ * grid and for the float and integer square roots (see arduino/kinematics.h). Fails with a non-zero exit status if a curvature
+ * correction of the grid does not fit in its 16 bits.
+ */
+
+// The standard headers must be included before the min() and max() macros of Arduino.h.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <kinematics.h>
+
+/// Distance between two compared points, in micrometers.
+#define SAMPLE_STEP 500
+
+/// Maximum length of a configuration line.
+#define LINE_MAX_LENGTH 64
+
+static long span, sheetPosX, sheetPosY, sheetWidth, sheetHeight;
+static LengthTable table;
+
+/**
+ * Read the plotter geometry from the configuration file, in micrometers.
+ */
+static bool readConfig(const char *fileName) {
+	FILE *config = fopen(fileName, "r");
+	if (!config) {
+		perror(fileName);
+		return false;
+	}
+
+	char line[LINE_MAX_LENGTH];
+	while (fgets(line, sizeof(line), config)) {
+		char *value = strchr(line, '=');
+		if (!value) {
+			continue;
+		}
+		*value++ = '\0';
+		long micrometers = atol(value) * 1000;
+
+		if (!strcmp(line, "span")) {
+			span = micrometers;
+		} else if (!strcmp(line, "sheetPosX")) {
+			sheetPosX = micrometers;
+		} else if (!strcmp(line, "sheetPosY")) {
+			sheetPosY = micrometers;
+		} else if (!strcmp(line, "sheetWidth")) {
+			sheetWidth = micrometers;
+		} else if (!strcmp(line, "sheetHeight")) {
+			sheetHeight = micrometers;
+		}
+	}
+	fclose(config);
+
+	return span > 0 && sheetWidth > 0 && sheetHeight > 0;
+}
+
+/**
+ * Get the greatest curvature correction of the grid cells, as LengthTable::build() computes them but
+ * without their 16 bits limit.
+ */
+static double getMaxCurvature(long minDx, long minDy, long maxDx, long maxDy) {
+	long extent = max(maxDx - minDx, maxDy - minDy);
+	int cellShift = 0;
+	while (((long) (KIN_TABLE_SIZE - 1) << cellShift) < extent) {
+		cellShift++;
+	}
+	double cellSize = 1L << cellShift;
+	double maxCurvature = 0;
+
+	for (int i = 0; i < KIN_TABLE_SIZE - 1; i++) {
+		for (int j = 0; j < KIN_TABLE_SIZE - 1; j++) {
+			double x = minDx + (i + 0.5) * cellSize;
+			double y = minDy + (j + 0.5) * cellSize;
+			double length = hypot(x, y);
+			double factor = KIN_STEPS_BY_KM / 1000000000.0 * cellSize / 2 * cellSize
+					/ (length * length * length);
+
+			maxCurvature = max(maxCurvature, round(max(x * x, y * y) * factor));
+		}
+	}
+	return maxCurvature;
+}
+
+/**
+ * Get a belt length from the grid.
+ */
+static unsigned long getTableLength(long dx, long dy) {
+	return table.getLength(dx, dy);
+}
+
+/**
+ * Get the time of a belt length on the computer, over the sheet.
+ * \param getLength The function computing the length.
+ * \return The mean time by length, in nanoseconds.
+ */
+static double getTime(unsigned long (*getLength)(long dx, long dy)) {
+	volatile unsigned long sum = 0;
+	long nbLengths = 0;
+	timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (long x = 0; x <= sheetWidth; x += SAMPLE_STEP) {
+		for (long y = 0; y <= sheetHeight; y += SAMPLE_STEP) {
+			sum += getLength(sheetPosX + x, sheetPosY + sheetHeight - y);
+			sum += getLength(span - sheetPosX - x, sheetPosY + sheetHeight - y);
+			nbLengths += 2;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec) / nbLengths;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <config file>\n", argv[0]);
+		return 1;
+	}
+
+	if (!readConfig(argv[1])) {
+		fprintf(stderr, "%s: missing plotter geometry\n", argv[1]);
+		return 1;
+	}
+
+	long minDx = min(sheetPosX, span - sheetPosX - sheetWidth);
+	long maxDx = max(sheetPosX + sheetWidth, span - sheetPosX);
+	table.build(minDx, sheetPosY, maxDx, sheetPosY + sheetHeight);
+	double maxCurvature = getMaxCurvature(minDx, sheetPosY, maxDx, sheetPosY + sheetHeight);
+
+	long maxError = 0;
+	double totalError = 0;
+	long nbLengths = 0;
+
+	for (long x = 0; x <= sheetWidth; x += SAMPLE_STEP) {
+		for (long y = 0; y <= sheetHeight; y += SAMPLE_STEP) {
+			long dxs[2] = { sheetPosX + x, span - sheetPosX - x };
+			long dy = sheetPosY + sheetHeight - y;
+
+			for (int belt = 0; belt < 2; belt++) {
+				long error = labs((long) table.getLength(dxs[belt], dy)
+						- (long) beltLength(dxs[belt], dy));
+				if (error > maxError) {
+					maxError = error;
+				}
+				totalError += error;
+				nbLengths++;
+			}
+		}
+	}
+
+	double micrometersByStep = 1000000000.0 / KIN_STEPS_BY_KM;
+	printf("grid: %d x %d nodes, %d bytes on the plotter\n", KIN_TABLE_SIZE, KIN_TABLE_SIZE,
+			KIN_TABLE_SIZE * KIN_TABLE_SIZE * 4 + (KIN_TABLE_SIZE - 1) * (KIN_TABLE_SIZE - 1) * 4);
+	printf("max error: %ld steps (%.1f um)\n", maxError, maxError * micrometersByStep);
+	printf("mean error: %.2f steps (%.1f um)\n", totalError / nbLengths,
+			totalError / nbLengths * micrometersByStep);
+	printf("max curvature correction: %.0f steps (%d at most)\n", maxCurvature, KIN_TABLE_MAX_CURVATURE);
+	printf("time by length: %.0f ns with the grid, %.0f ns in float, %.0f ns in integer\n",
+			getTime(getTableLength), getTime(floatBeltLength), getTime(integerBeltLength));
+
+	if (maxCurvature > KIN_TABLE_MAX_CURVATURE) {
+		fprintf(stderr, "a curvature correction does not fit in 16 bits: its cell lengths are computed\n");
+		return 1;
+	}
+	return 0;
+}
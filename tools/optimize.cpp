@@ -0,0 +1,329 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Reorder the paths of a GCode drawing to reduce the pen-up travel and the pen lifts.
+ * Build: g++ -O2 -o optimize optimize.cpp
+ * Usage: optimize <input GCode file> <output GCode file>
+ * The drawing is split in paths, drawn without lifting the pen. They are ordered by nearest neighbour from
+ * the drawing origin, then improved by 2-opt, each path being drawn in either direction. Consecutive paths
+ * which meet are drawn without lifting the pen. The G04 waits are kept in place: the paths are only
+ * reordered between them. The output can be compiled into a binary drawing with gcode2bin.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/// Maximum length of a GCode line.
+#define LINE_MAX_LENGTH 256
+
+/// Maximum number of 2-opt passes on each group of paths.
+#define MAX_PASSES 50
+
+typedef struct {
+	double x;
+	double y;
+} Point;
+
+/**
+ * A path drawn without lifting the pen.
+ */
+typedef struct {
+	std::vector<Point> points;
+	bool isReversed; ///< \a true to draw the path from its last point.
+} Path;
+
+/**
+ * Paths to reorder, followed by a line to keep in place (a wait), if any.
+ */
+typedef struct {
+	std::vector<Path> paths;
+	std::string barrier;
+} Group;
+
+static const Point &getStart(const Path &path) {
+	return path.isReversed ? path.points.back() : path.points.front();
+}
+
+static const Point &getEnd(const Path &path) {
+	return path.isReversed ? path.points.front() : path.points.back();
+}
+
+static double distance(const Point &a, const Point &b) {
+	return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+static bool isSame(const Point &a, const Point &b) {
+	return a.x == b.x && a.y == b.y;
+}
+
+/**
+ * Pen-up travel to draw paths in their order, from a position.
+ */
+static double getTravel(const std::vector<Path> &paths, Point position) {
+	double travel = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		travel += distance(position, getStart(paths[i]));
+		position = getEnd(paths[i]);
+	}
+	return travel;
+}
+
+/**
+ * Order the paths by nearest neighbour, from a position.
+ */
+static void sortByNearest(std::vector<Path> &paths, Point position) {
+	for (size_t i = 0; i < paths.size(); i++) {
+		size_t best = i;
+		bool isBestReversed = false;
+		double bestDistance = INFINITY;
+
+		for (size_t j = i; j < paths.size(); j++) {
+			double toFront = distance(position, paths[j].points.front());
+			double toBack = distance(position, paths[j].points.back());
+			if (toFront < bestDistance) {
+				best = j;
+				bestDistance = toFront;
+				isBestReversed = false;
+			}
+			if (toBack < bestDistance) {
+				best = j;
+				bestDistance = toBack;
+				isBestReversed = true;
+			}
+		}
+
+		std::swap(paths[i], paths[best]);
+		paths[i].isReversed = isBestReversed;
+		position = getEnd(paths[i]);
+	}
+}
+
+/**
+ * Improve the order by 2-opt: reverse the sequence of paths between i and j, each path being reversed too,
+ * when it shortens the travel. The last path has no following travel.
+ */
+static void improve(std::vector<Path> &paths, Point position) {
+	size_t n = paths.size();
+
+	for (int pass = 0; pass < MAX_PASSES; pass++) {
+		bool isImproved = false;
+
+		for (size_t i = 0; i < n; i++) {
+			const Point &before = i == 0 ? position : getEnd(paths[i - 1]);
+
+			for (size_t j = i + 1; j < n; j++) {
+				// Travels replaced by the reversal: before -> start of i, and end of j -> start of j + 1
+				double oldTravel = distance(before, getStart(paths[i]));
+				double newTravel = distance(before, getEnd(paths[j]));
+				if (j + 1 < n) {
+					oldTravel += distance(getEnd(paths[j]), getStart(paths[j + 1]));
+					newTravel += distance(getStart(paths[i]), getStart(paths[j + 1]));
+				}
+
+				if (newTravel < oldTravel - 1e-9) {
+					std::reverse(paths.begin() + i, paths.begin() + j + 1);
+					for (size_t k = i; k <= j; k++) {
+						paths[k].isReversed = !paths[k].isReversed;
+					}
+					isImproved = true;
+				}
+			}
+		}
+
+		if (!isImproved) {
+			break;
+		}
+	}
+}
+
+/**
+ * Format a coordinate, without the useless zeros.
+ */
+static std::string format(double value) {
+	char text[32];
+	sprintf(text, "%.4f", value);
+
+	std::string result = text;
+	result.erase(result.find_last_not_of('0') + 1);
+	if (result[result.size() - 1] == '.') {
+		result.erase(result.size() - 1);
+	}
+	return result == "-0" ? "0" : result;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input GCode file> <output GCode file>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *input = fopen(argv[1], "r");
+	if (!input) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	std::vector<std::string> comments;
+	std::vector<Group> groups(1);
+	char line[LINE_MAX_LENGTH];
+	Point position = { 0, 0 };
+	bool isPenDown = false;
+	bool isPathOpen = false;
+	long nbUnknown = 0;
+	long oldLifts = 0;
+
+	while (fgets(line, sizeof(line), input)) {
+		std::string text = line;
+		char *function = strtok(line, " \t\r\n");
+
+		if (!function) {
+			continue;
+		} else if (function[0] == '#' || function[0] == ';' || function[0] == '(') {
+			comments.push_back(text);
+			continue;
+		}
+
+		Point target = position;
+		double z = 0;
+		char *word;
+
+		while ((word = strtok(NULL, " \t\r\n"))) {
+			switch (word[0]) {
+			case 'X':
+				target.x = atof(word + 1);
+				break;
+			case 'Y':
+				target.y = atof(word + 1);
+				break;
+			case 'Z':
+				z = atof(word + 1);
+				break;
+			}
+		}
+
+		bool shouldWrite;
+		if (!strcmp(function, "G00")) {
+			shouldWrite = false;
+		} else if (!strcmp(function, "G01")) {
+			shouldWrite = z <= 0;
+		} else if (!strcmp(function, "G04")) {
+			// The wait does not lift the pen, but the next lines start a new path.
+			groups.back().barrier = text;
+			groups.push_back(Group());
+			isPathOpen = false;
+			continue;
+		} else {
+			if (strcmp(function, "G21") && strcmp(function, "M30")) {
+				nbUnknown++;
+			}
+			continue;
+		}
+
+		if (shouldWrite) {
+			if (!isPathOpen) {
+				Path path;
+				path.points.push_back(position);
+				path.isReversed = false;
+				groups.back().paths.push_back(path);
+			}
+			std::vector<Point> &points = groups.back().paths.back().points;
+			if (!isSame(points.back(), target)) {
+				points.push_back(target);
+			}
+		}
+
+		if (shouldWrite && !isPenDown) {
+			oldLifts++;
+		}
+
+		isPenDown = shouldWrite;
+		isPathOpen = shouldWrite;
+		position = target;
+	}
+	fclose(input);
+
+	FILE *output = fopen(argv[2], "w");
+	if (!output) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	for (size_t i = 0; i < comments.size(); i++) {
+		fputs(comments[i].c_str(), output);
+	}
+
+	Point origin = { 0, 0 };
+	Point oldPosition = origin;
+	double oldTravel = 0;
+	double newTravel = 0;
+	long newLifts = 0;
+	size_t nbPaths = 0;
+	position = origin;
+	isPenDown = false;
+
+	for (size_t g = 0; g < groups.size(); g++) {
+		std::vector<Path> &paths = groups[g].paths;
+
+		oldTravel += getTravel(paths, oldPosition);
+		if (!paths.empty()) {
+			oldPosition = getEnd(paths.back());
+		}
+		sortByNearest(paths, position);
+		improve(paths, position);
+		newTravel += getTravel(paths, position);
+		nbPaths += paths.size();
+
+		for (size_t i = 0; i < paths.size(); i++) {
+			const Path &path = paths[i];
+			size_t n = path.points.size();
+
+			if (!isPenDown || !isSame(position, getStart(path))) {
+				newLifts++;
+				fprintf(output, "G00 X%s Y%s\n", format(getStart(path).x).c_str(),
+						format(getStart(path).y).c_str());
+
+				// A dot: the pen goes down on its point, and up with the next move.
+				if (n == 1) {
+					fprintf(output, "G01 X%s Y%s\n", format(getStart(path).x).c_str(),
+							format(getStart(path).y).c_str());
+				}
+			}
+
+			for (size_t k = 1; k < n; k++) {
+				const Point &point = path.points[path.isReversed ? n - 1 - k : k];
+				fprintf(output, "G01 X%s Y%s\n", format(point.x).c_str(), format(point.y).c_str());
+			}
+
+			isPenDown = true;
+			position = getEnd(path);
+		}
+
+		fputs(groups[g].barrier.c_str(), output);
+	}
+	fclose(output);
+
+	// Each pen lift ends a stroke: the lifts are counted from the strokes beginnings. In the input file,
+	// a lift is done even between two paths which meet.
+	printf("%lu paths, %ld unknown functions\n", (unsigned long) nbPaths, nbUnknown);
+	printf("pen-up travel: %.3f -> %.3f (%.1f%% saved)\n", oldTravel, newTravel,
+			oldTravel > 0 ? 100 * (oldTravel - newTravel) / oldTravel : 0);
+	printf("pen lifts: %ld -> %ld\n", oldLifts, newLifts);
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Simulated Arduino core: only the functions used by the plotter library are declared.
+ * They are implemented in simulator.cpp.
+ */
+
+#ifndef _H_ARDUINO_MOCK
+#define _H_ARDUINO_MOCK
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define B1 1
+#define B10 2
+#define B100 4
+
+#define PI 3.1415926535897932384626433832795
+#define F_CPU 16000000UL
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void noInterrupts();
+void interrupts();
+
+/**
+ * Formatting of the written values, shared by the serial link and the plotter SerialLink.
+ */
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	size_t print(const char *text);
+	size_t print(int value);
+	size_t print(unsigned int value);
+	size_t print(long value);
+	size_t print(unsigned long value);
+	size_t print(double value, int digits = 2);
+	size_t println(const char *text);
+	size_t println(int value);
+	size_t println(unsigned int value);
+	size_t println(long value);
+	size_t println(unsigned long value);
+	size_t println(double value, int digits = 2);
+	size_t println();
+};
+
+/**
+ * Simulated serial link: the written bytes are recorded in the trace.
+ */
+class HardwareSerial : public Print {
+public:
+	void begin(unsigned long bauds);
+	int available();
+	int availableForWrite();
+	int read();
+	size_t write(uint8_t c);
+};
+
+extern HardwareSerial Serial;
+
+#endif
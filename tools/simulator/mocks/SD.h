@@ -0,0 +1,58 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Simulated SD card library: the files are read from a directory of the computer.
+ */
+
+#ifndef _H_SD_MOCK
+#define _H_SD_MOCK
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <stdio.h>
+
+// The open flags of the SD library are the POSIX ones: as with the SD library, FILE_WRITE appends.
+#define FILE_READ O_RDONLY
+#define FILE_WRITE (O_RDWR | O_CREAT | O_APPEND)
+
+class File {
+public:
+	File(FILE *stream = NULL);
+	int available();
+	int read();
+	int read(void *buffer, uint16_t length);
+	size_t write(uint8_t c);
+	size_t write(const uint8_t *buffer, size_t length);
+	bool seek(uint32_t position);
+	uint32_t position();
+	uint32_t size();
+	void flush();
+	void close();
+	operator bool();
+
+private:
+	FILE *stream;
+};
+
+class SDClass {
+public:
+	bool begin(uint8_t csPin);
+	bool exists(const char *name);
+	bool remove(const char *name);
+	File open(const char *name, int mode = FILE_READ);
+};
+
+extern SDClass SD;
+
+#endif
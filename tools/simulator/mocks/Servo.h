@@ -0,0 +1,30 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Simulated servo-motor library: the angles are recorded in the trace.
+ */
+
+#ifndef _H_SERVO_MOCK
+#define _H_SERVO_MOCK
+
+#include <stdint.h>
+
+class Servo {
+public:
+	uint8_t attach(int pin);
+	void write(int angle);
+	int read();
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Simulated ATmega328P registers, only the ones used by the plotter library.
+ */
+
+#ifndef _H_AVR_IO_MOCK
+#define _H_AVR_IO_MOCK
+
+#include <stdint.h>
+
+/**
+ * Simulated output port register: its bits are the levels of the simulated pins, so the writes are
+ * traced like the ones of digitalWrite().
+ */
+class PortRegister {
+public:
+	/// \param firstPin The Arduino pin of the bit 0.
+	PortRegister(uint8_t firstPin);
+	operator uint8_t() const;
+	PortRegister &operator=(uint8_t value);
+	PortRegister &operator|=(uint8_t mask);
+	PortRegister &operator&=(uint8_t mask);
+
+private:
+	uint8_t firstPin;
+};
+
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIMSK2, TIFR2;
+extern volatile uint8_t DDRB, DDRC, DDRD, PINB, PINC, PIND;
+extern PortRegister PORTB, PORTC, PORTD;
+
+#define WGM21 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCF2A 1
+
+#define _BV(bit) (1 << (bit))
+
+#endif
@@ -0,0 +1,918 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Plotter simulator: run the unmodified plotter library on the computer, against the mocked Arduino,
+ * SD and Servo libraries of the mocks directory.
+ * Build, from this directory:
+ * g++ -O2 -DPROFILE_HOST -I mocks -I ../../arduino -o simulator simulator.cpp ../../arduino/{drawall,frame,kinematics,motors,planner,profiler,seriallink}.cpp
+ * Usage: simulator [--no-trace] [--pty] [--power-cut <seconds>] <SD card directory> <output prefix>
+ * The config and drawing files are read from the SD card directory, where the plotter can write its files.
+ * With --power-cut, the simulation stops this plot time after the motors power on, as a power cut, to
+ * resume the drawing with the next run (see Drawall::checkpointPeriodConf). With --pty, the serial link of the
+ * plotter is a pseudo-terminal, whose path is printed on the standard output, for the streamer of
+ * tools/stream. Its bytes are received at the speed given to Serial.begin() on the virtual clock, and the
+ * computer is assumed to answer instantly. The simulator writes:
+ * - <output prefix>.trace: one line by event, "<time in µs> <event> <value>", for each pin edge, servo
+ * angle and serial byte, unless --no-trace is given;
+ * - <output prefix>.svg: the path of the pen on the sheet, drawn lines in black and moves in grey;
+ * - <output prefix>.stats: the plot statistics, as "key=value" lines (see writeStats()).
+ * The virtual clock is driven by the Timer2 interrupt. The code running outside of the interrupts costs
+ * no time, except SIM_CALL_CYCLES cycles for each call to the time and serial functions, so the plot time
+ * is the one of a plotter whose main loop is never late.
+ */
+
+// The standard headers must be included before the min() and max() macros of Arduino.h.
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <drawall.h>
+
+/// CPU cycles spent by each call to micros(), millis(), interrupts() and Serial.write().
+#define SIM_CALL_CYCLES 64
+
+/// Minimum pen move between two points of the SVG path, in mm.
+#define SIM_SVG_RESOLUTION 0.1
+
+/// Number of simulated digital pins.
+#define SIM_NB_PINS 22
+
+/// Size of the serial receive buffer of the Arduino core: the bytes received when it is full are lost.
+#define SIM_SERIAL_BUFFER_SIZE 64
+
+/// Time to wait for the computer on the pseudo-terminal before giving up, in ms.
+#define SIM_SERIAL_TIMEOUT 10000
+
+/// Time to wait for the computer, once it has sent its first bytes, before the simulated time goes on by as
+/// much, in ms. The plotter can then notice a silent computer.
+#define SIM_SERIAL_WAIT 20
+
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIMSK2, TIFR2;
+volatile uint8_t DDRB, DDRC, DDRD, PINB, PINC, PIND;
+PortRegister PORTB(8), PORTC(14), PORTD(0);
+
+HardwareSerial Serial;
+SDClass SD;
+
+/**
+ * A point of the pen path, in mm from the top left corner of the sheet.
+ */
+typedef struct {
+	float x;
+	float y;
+} Point;
+
+/**
+ * A part of the pen path, where the pen stays up or down.
+ */
+typedef struct {
+	bool isWriting;
+	std::vector<Point> points;
+} Path;
+
+/**
+ * A segment queued to the motors (see profileSegment()), in mm from the top left corner of the sheet.
+ */
+typedef struct {
+	Point start;
+	Point end;
+	long leftLength;  ///< Left belt length at the end of the segment, in steps.
+	long rightLength; ///< Right belt length at the end of the segment, in steps.
+} Segment;
+
+static std::string sdDirectory;
+static std::string outputPrefix;
+static FILE *trace; ///< The trace file, or NULL if disabled.
+
+static unsigned long long cycles = 0;     ///< Virtual clock, in CPU cycles.
+static unsigned long long nextInterrupt;  ///< Time of the next Timer2 interrupt, in CPU cycles.
+static bool areInterruptsEnabled = true;
+static bool isInterrupting = false;
+
+static uint8_t pins[SIM_NB_PINS];
+static int servoAngle = -1;
+
+static unsigned long long startCycles = 0; ///< Time when the motors have been powered.
+static unsigned long long powerCutCycles = 0; ///< Plot time of the power cut, or 0 without --power-cut.
+static unsigned long stepsNumber = 0;
+static unsigned long stepEvents = 0;        ///< Number of interrupts with at least one step.
+static unsigned long long interruptsNumber = 0;///< Number of Timer2 interrupts.
+static unsigned long long lastStepInterrupt = 0;
+static unsigned long penCycles = 0;
+
+// Plotter geometry, read from the config file, in mm
+static float span, sheetPosX, sheetPosY, sheetWidth, sheetHeight, initPosX, initPosY;
+
+static long leftLength;  ///< Left belt length, in steps.
+static long rightLength; ///< Right belt length, in steps.
+static std::vector<Path> paths;
+static std::deque<Segment> segments; ///< The queued segments, from the one the motors are running.
+
+// Distance between the pen and its segment at each step while writing, in mm
+static float maxDeviation = 0;
+static double totalDeviation = 0;
+static unsigned long deviationSamples = 0;
+
+static float maxSpeed; ///< Maximum drawing speed, in mm/s.
+
+/**
+ * A byte sent by the computer on the pseudo-terminal.
+ */
+typedef struct {
+	uint8_t value;
+	unsigned long long arrival; ///< Time when the plotter receives it, in CPU cycles.
+} SerialByte;
+
+static int serialPort = -1; ///< The master side of the pseudo-terminal, or -1 without --pty.
+static std::deque<SerialByte> received;
+static unsigned long serialBauds = SERIAL_BAUDS; ///< Speed given to Serial.begin().
+static unsigned long long lastArrival = 0;
+static unsigned long silentTime = 0; ///< Time without any byte from the computer, in ms.
+static unsigned long long lastWrite = 0; ///< Time of the last byte sent to the computer, in CPU cycles.
+static unsigned long long lastSerialCheck = 0;
+static unsigned long long starvedCycles = 0; ///< Time with idle motors while waiting for the serial link.
+
+/// Profiling section of the simulator itself, counted apart from the plotter code.
+#define PROFILE_SIMULATOR PROFILE_NB_SECTIONS
+
+// Time spent on the computer by the profiled sections, in nanoseconds, excluding the nested sections
+static unsigned long long sectionTimes[PROFILE_NB_SECTIONS + 1];
+static unsigned long sectionCalls[PROFILE_NB_SECTIONS + 1];
+static int sectionStack[8];
+static int stackSize = 0;
+static unsigned long long lastSwitch; ///< Time of the last section change, in nanoseconds.
+static unsigned long long startTime;  ///< Time of the simulation start, in nanoseconds.
+
+static unsigned long long getMicros() {
+	return cycles / (F_CPU / 1000000);
+}
+
+/**
+ * Get the time of the computer, in nanoseconds.
+ */
+static unsigned long long getHostTime() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void traceEvent(const char *event, int value) {
+	if (trace) {
+		fprintf(trace, "%llu %s %d\n", getMicros(), event, value);
+	}
+}
+
+void profileEnter(unsigned char section) {
+	unsigned long long now = getHostTime();
+
+	if (stackSize > 0) {
+		sectionTimes[sectionStack[stackSize - 1]] += now - lastSwitch;
+	}
+	sectionStack[stackSize++] = section;
+	sectionCalls[section]++;
+	lastSwitch = now;
+}
+
+void profileExit(unsigned char section) {
+	unsigned long long now = getHostTime();
+
+	sectionTimes[section] += now - lastSwitch;
+	stackSize--;
+	lastSwitch = now;
+}
+
+static void finish();
+
+/**
+ * Move the virtual clock forward, calling the Timer2 interrupt when it is due.
+ */
+static void advance(unsigned long long duration) {
+	unsigned long long end = cycles + duration;
+
+	profileEnter(PROFILE_SIMULATOR);
+
+	// The interrupt is enabled by Motors::start(), with a prescaler of 8.
+	if (nextInterrupt == 0) {
+		nextInterrupt = cycles + 8 * (OCR2A + 1UL);
+	}
+
+	while ((TIMSK2 & _BV(OCIE2A)) && areInterruptsEnabled && !isInterrupting
+			&& nextInterrupt <= end) {
+		cycles = nextInterrupt;
+		nextInterrupt += 8 * (OCR2A + 1UL);
+
+		interruptsNumber++;
+		isInterrupting = true;
+		PROFILE_ENTER(PROFILE_STEPPING);
+		TIMER2_COMPA_vect();
+		PROFILE_EXIT(PROFILE_STEPPING);
+		isInterrupting = false;
+	}
+
+	if (cycles < end) {
+		cycles = end;
+	}
+
+	profileExit(PROFILE_SIMULATOR);
+
+	if (powerCutCycles > 0 && cycles - startCycles >= powerCutCycles) {
+		finish();
+	}
+}
+
+static const char *getPinName(uint8_t pin) {
+	static char name[8];
+
+	switch (pin) {
+	case PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_STEP : PIN_LEFT_MOTOR_STEP:
+		return "leftStep";
+	case PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_DIR : PIN_LEFT_MOTOR_DIR:
+		return "leftDir";
+	case PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_STEP : PIN_RIGHT_MOTOR_STEP:
+		return "rightStep";
+	case PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_DIR : PIN_RIGHT_MOTOR_DIR:
+		return "rightDir";
+	case PIN_ENABLE_MOTORS:
+		return "enable";
+	}
+
+	sprintf(name, "pin%d", pin);
+	return name;
+}
+
+/**
+ * Read the plotter geometry and speed from the config file, like Drawall::loadParameters() does.
+ */
+static void loadConfig() {
+	FILE *config = fopen((sdDirectory + "/config").c_str(), "r");
+	char line[64];
+	char key[32];
+	float value;
+
+	if (!config) {
+		perror("config");
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), config)) {
+		if (sscanf(line, "%31[^=]=%f", key, &value) != 2) {
+			continue;
+		}
+
+		std::string name = key;
+		if (name == "span") {
+			span = value;
+		} else if (name == "sheetPosX") {
+			sheetPosX = value;
+		} else if (name == "sheetPosY") {
+			sheetPosY = value;
+		} else if (name == "sheetWidth") {
+			sheetWidth = value;
+		} else if (name == "sheetHeight") {
+			sheetHeight = value;
+		} else if (name == "initPosX") {
+			initPosX = value;
+		} else if (name == "initPosY") {
+			initPosY = value;
+		} else if (name == "maxSpeed") {
+			maxSpeed = value;
+		}
+	}
+
+	fclose(config);
+
+	// Same belt lengths as Drawall::positionToLeftLength() and positionToRightLength()
+	leftLength = beltLength((sheetPosX + initPosX) * 1000,
+			(sheetPosY + sheetHeight - initPosY) * 1000);
+	rightLength = beltLength((span - sheetPosX - initPosX) * 1000,
+			(sheetPosY + sheetHeight - initPosY) * 1000);
+}
+
+/**
+ * Get the pen position, in mm from the top left corner of the sheet.
+ */
+static Point getPenPosition() {
+	// Same forward kinematics as Drawall::lengthsToPosition(), in mm
+	float left = leftLength * 1000000.0 / KIN_STEPS_BY_KM;
+	float right = rightLength * 1000000.0 / KIN_STEPS_BY_KM;
+	float x = (left * left - right * right + span * span) / (2 * span);
+	Point point = { x - sheetPosX, sqrt(left * left - x * x) - sheetPosY };
+
+	return point;
+}
+
+/**
+ * Add the current pen position to the path.
+ */
+static void addPoint() {
+	Point point = getPenPosition();
+	bool isWriting = servoAngle == PLT_MIN_SERVO_ANGLE;
+
+	if (paths.empty() || paths.back().isWriting != isWriting) {
+		Path path;
+		path.isWriting = isWriting;
+		if (!paths.empty()) {
+			path.points.push_back(paths.back().points.back());
+		}
+		paths.push_back(path);
+	}
+
+	std::vector<Point> &points = paths.back().points;
+	if (!points.empty()) {
+		float dx = point.x - points.back().x;
+		float dy = point.y - points.back().y;
+		if (dx * dx + dy * dy < SIM_SVG_RESOLUTION * SIM_SVG_RESOLUTION) {
+			return;
+		}
+	}
+	points.push_back(point);
+}
+
+void profileSegment(float startX, float startY, float endX, float endY, long leftLength, long rightLength) {
+	Segment segment = { { startX, sheetHeight - startY }, { endX, sheetHeight - endY }, leftLength,
+			rightLength };
+
+	segments.push_back(segment);
+}
+
+/**
+ * Measure the distance between the pen and the segment run by the motors, if the pen writes, then go to the
+ * next segment once its end is reached.
+ */
+static void measureDeviation() {
+	if (segments.empty()) {
+		return;
+	}
+
+	const Segment &segment = segments.front();
+	if (servoAngle == PLT_MIN_SERVO_ANGLE) {
+		Point pen = getPenPosition();
+		float dx = segment.end.x - segment.start.x;
+		float dy = segment.end.y - segment.start.y;
+		float length2 = dx * dx + dy * dy;
+		float t = length2 > 0 ? ((pen.x - segment.start.x) * dx + (pen.y - segment.start.y) * dy) / length2 : 0;
+
+		t = constrain(t, 0, 1);
+		float deviation = hypot(pen.x - segment.start.x - t * dx, pen.y - segment.start.y - t * dy);
+		maxDeviation = max(maxDeviation, deviation);
+		totalDeviation += deviation;
+		deviationSamples++;
+	}
+
+	// Each belt goes one way on a segment, so its end lengths are not reached before.
+	if (leftLength == segment.leftLength && rightLength == segment.rightLength) {
+		segments.pop_front();
+	}
+}
+
+static void writeSvg(const char *fileName) {
+	FILE *svg = fopen(fileName, "w");
+	if (!svg) {
+		perror(fileName);
+		return;
+	}
+
+	fprintf(svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%gmm\" height=\"%gmm\""
+			" viewBox=\"0 0 %g %g\">\n", sheetWidth, sheetHeight, sheetWidth, sheetHeight);
+	for (size_t i = 0; i < paths.size(); i++) {
+		fprintf(svg, "<polyline fill=\"none\" stroke=\"%s\" stroke-width=\"%s\" points=\"",
+				paths[i].isWriting ? "black" : "silver", paths[i].isWriting ? "0.3" : "0.1");
+		for (size_t j = 0; j < paths[i].points.size(); j++) {
+			fprintf(svg, "%.2f,%.2f ", paths[i].points[j].x, paths[i].points[j].y);
+		}
+		fprintf(svg, "\"/>\n");
+	}
+	fprintf(svg, "</svg>\n");
+
+	fclose(svg);
+}
+
+/**
+ * Get the number of GCode lines or binary records parsed by second of the parsing section.
+ */
+static float getParseRate() {
+	if (sectionTimes[PROFILE_PARSING] == 0) {
+		return 0;
+	}
+	return sectionCalls[PROFILE_PARSING] * 1e9 / sectionTimes[PROFILE_PARSING];
+}
+
+/**
+ * Write the plot statistics:
+ * - plotTime: simulated time from the motors power on to their power off, in s;
+ * - steps and penCycles: number of motor steps, on both motors, and pen lifts;
+ * - stepEvents: number of interrupts where at least one motor steps;
+ * - stepRate: average number of step events by second, to compare with nominalStepRate, the number of
+ * step events by second at the maximum speed (as delayBetweenSteps);
+ * - starvedTime: time when the motors are idle while the plotter waits for the serial link, in s;
+ * - maxDeviation and meanDeviation: greatest and average distance between the pen and the segment it draws,
+ * at each step, in µm;
+ * - parsingTime, kinematicsTime, steppingTime, waitingTime, segmentTime and penTime: time spent on the
+ * computer by the profiled sections (see profiler.h), in µs, with their number of calls (parsingCalls,
+ * kinematicsCalls...);
+ * - simulatorTime: time spent by the simulator itself, out of the interrupts, in µs;
+ * - parseRate: number of GCode lines or binary records read by second of parsingTime, that is, the
+ * throughput of the drawing reader on the computer;
+ * - otherTime: the rest of the time spent on the computer, in µs.
+ */
+static void writeStats(const char *fileName) {
+	FILE *stats = fopen(fileName, "w");
+	if (!stats) {
+		perror(fileName);
+		return;
+	}
+
+	float plotTime = (cycles - startCycles) / (float) F_CPU;
+	unsigned long long otherTime = getHostTime() - startTime;
+	const char *names[PROFILE_NB_SECTIONS + 1] = { "parsing", "kinematics", "stepping", "waiting",
+			"segment", "pen", "simulator" };
+
+	fprintf(stats, "plotTime=%.3f\n", plotTime);
+	fprintf(stats, "steps=%lu\n", stepsNumber);
+	fprintf(stats, "penCycles=%lu\n", penCycles);
+	fprintf(stats, "stepEvents=%lu\n", stepEvents);
+	fprintf(stats, "stepRate=%.0f\n", stepEvents / plotTime);
+	fprintf(stats, "nominalStepRate=%.0f\n", maxSpeed * KIN_STEPS_BY_KM / 1000000.0);
+	fprintf(stats, "starvedTime=%.3f\n", starvedCycles / (float) F_CPU);
+	fprintf(stats, "maxDeviation=%.1f\n", maxDeviation * 1000);
+	fprintf(stats, "meanDeviation=%.2f\n", deviationSamples > 0 ? totalDeviation * 1000 / deviationSamples : 0);
+
+	for (int i = 0; i <= PROFILE_NB_SECTIONS; i++) {
+		fprintf(stats, "%sTime=%llu\n", names[i], sectionTimes[i] / 1000);
+		if (i < PROFILE_NB_SECTIONS) {
+			fprintf(stats, "%sCalls=%lu\n", names[i], sectionCalls[i]);
+		}
+		otherTime -= sectionTimes[i];
+	}
+	fprintf(stats, "parseRate=%.0f\n", getParseRate());
+	fprintf(stats, "otherTime=%llu\n", otherTime / 1000);
+
+	fclose(stats);
+}
+
+/**
+ * Called when the motors are powered off at the end of the drawing.
+ */
+static void finish() {
+	addPoint();
+	if (trace) {
+		fclose(trace);
+	}
+	writeSvg((outputPrefix + ".svg").c_str());
+	writeStats((outputPrefix + ".stats").c_str());
+
+	printf("plot time: %.3f s\n", (cycles - startCycles) / (float) F_CPU);
+	printf("steps: %lu\n", stepsNumber);
+	printf("pen cycles: %lu\n", penCycles);
+	printf("parse rate: %.0f lines or records by second\n", getParseRate());
+	exit(0);
+}
+
+static void countStep() {
+	stepsNumber++;
+	if (lastStepInterrupt != interruptsNumber) {
+		lastStepInterrupt = interruptsNumber;
+		stepEvents++;
+	}
+	addPoint();
+	measureDeviation();
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	if (pin >= SIM_NB_PINS || pins[pin] == value) {
+		return;
+	}
+	pins[pin] = value;
+
+	traceEvent(getPinName(pin), value);
+
+	if (pin == (PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_STEP : PIN_LEFT_MOTOR_STEP)) {
+		leftLength += pins[PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_DIR : PIN_LEFT_MOTOR_DIR]
+				== PLT_LEFT_DIRECTION ? -1 : 1;
+		countStep();
+	} else if (pin == (PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_STEP : PIN_RIGHT_MOTOR_STEP)) {
+		rightLength += pins[PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_DIR : PIN_RIGHT_MOTOR_DIR]
+				== PLT_RIGHT_DIRECTION ? -1 : 1;
+		countStep();
+	} else if (pin == PIN_ENABLE_MOTORS) {
+		if (value == LOW) {
+			startCycles = cycles;
+		} else {
+			finish();
+		}
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	return pin < SIM_NB_PINS ? pins[pin] : LOW;
+}
+
+PortRegister::PortRegister(uint8_t firstPin) :
+		firstPin(firstPin) {
+}
+
+PortRegister::operator uint8_t() const {
+	uint8_t value = 0;
+	for (int bit = 0; bit < 8; bit++) {
+		value |= digitalRead(firstPin + bit) << bit;
+	}
+	return value;
+}
+
+PortRegister &PortRegister::operator=(uint8_t value) {
+	// The port bits change at once: their pins are traced in the bits order.
+	for (int bit = 0; bit < 8; bit++) {
+		digitalWrite(firstPin + bit, (value >> bit) & 1);
+	}
+	return *this;
+}
+
+PortRegister &PortRegister::operator|=(uint8_t mask) {
+	return *this = *this | mask;
+}
+
+PortRegister &PortRegister::operator&=(uint8_t mask) {
+	return *this = *this & mask;
+}
+
+unsigned long micros() {
+	advance(SIM_CALL_CYCLES);
+	return getMicros();
+}
+
+unsigned long millis() {
+	advance(SIM_CALL_CYCLES);
+	return getMicros() / 1000;
+}
+
+void delay(unsigned long ms) {
+	advance(ms * (F_CPU / 1000));
+}
+
+void delayMicroseconds(unsigned int us) {
+	advance(us * (F_CPU / 1000000));
+}
+
+void noInterrupts() {
+	areInterruptsEnabled = false;
+}
+
+void interrupts() {
+	areInterruptsEnabled = true;
+	advance(SIM_CALL_CYCLES);
+}
+
+void HardwareSerial::begin(unsigned long bauds) {
+	serialBauds = bauds;
+}
+
+/**
+ * Open the pseudo-terminal used as the serial link.
+ */
+static bool openSerialPort() {
+	serialPort = posix_openpt(O_RDWR | O_NOCTTY);
+	if (serialPort < 0 || grantpt(serialPort) || unlockpt(serialPort)) {
+		perror("pseudo-terminal");
+		return false;
+	}
+
+	// The slave side stays open, in raw mode, so the plotter output is not echoed back while the streamer
+	// is not connected yet.
+	int slave = open(ptsname(serialPort), O_RDWR | O_NOCTTY);
+	struct termios settings;
+	if (slave < 0 || tcgetattr(slave, &settings)) {
+		perror(ptsname(serialPort));
+		return false;
+	}
+	cfmakeraw(&settings);
+	tcsetattr(slave, TCSANOW, &settings);
+
+	printf("serial: %s\n", ptsname(serialPort));
+	fflush(stdout);
+	return true;
+}
+
+/**
+ * Receive the bytes sent by the computer, waiting for them if none is pending.
+ */
+static void receiveSerial() {
+	int timeout = !received.empty() ? 0 : lastArrival == 0 ? SIM_SERIAL_TIMEOUT : SIM_SERIAL_WAIT;
+	struct pollfd request = { serialPort, POLLIN, 0 };
+	int result = poll(&request, 1, timeout);
+
+	if (result == 0 && received.empty()) {
+		silentTime += timeout;
+		if (silentTime >= SIM_SERIAL_TIMEOUT) {
+			fprintf(stderr, "serial link: timeout\n");
+			exit(1);
+		}
+		advance(F_CPU / 1000 * SIM_SERIAL_WAIT);
+		return;
+	}
+	silentTime = 0;
+
+	uint8_t buffer[256];
+	ssize_t length = result > 0 ? read(serialPort, buffer, sizeof(buffer)) : 0;
+
+	for (ssize_t i = 0; i < length; i++) {
+		// The computer answers as soon as it receives the plotter output, whatever the time it really took
+		// to do it. 10 bits by byte, with the start and stop bits.
+		SerialByte serialByte = { buffer[i], max(lastWrite, lastArrival) + F_CPU * 10ULL / serialBauds };
+		received.push_back(serialByte);
+		lastArrival = serialByte.arrival;
+	}
+}
+
+int HardwareSerial::available() {
+	if (serialPort < 0) {
+		return 0;
+	}
+
+	receiveSerial();
+
+	int arrived = 0;
+	while (arrived < (int) received.size() && received[arrived].arrival <= cycles) {
+		arrived++;
+	}
+
+	if (arrived > SIM_SERIAL_BUFFER_SIZE) {
+		fprintf(stderr, "serial link: receive buffer overflow\n");
+		exit(1);
+	}
+
+	if (arrived == 0 && motors.isIdle()) {
+		starvedCycles += cycles - lastSerialCheck;
+	}
+	lastSerialCheck = cycles;
+
+	return arrived;
+}
+
+int HardwareSerial::availableForWrite() {
+	return 64;
+}
+
+int HardwareSerial::read() {
+	if (available() == 0) {
+		return -1;
+	}
+
+	uint8_t value = received.front().value;
+	received.pop_front();
+	return value;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+	advance(SIM_CALL_CYCLES);
+	traceEvent("serial", c);
+	lastWrite = cycles;
+	if (serialPort >= 0 && ::write(serialPort, &c, 1) != 1) {
+		perror("serial link");
+		exit(1);
+	}
+	return 1;
+}
+
+size_t Print::print(const char *text) {
+	size_t i;
+	for (i = 0; text[i]; i++) {
+		write(text[i]);
+	}
+	return i;
+}
+
+size_t Print::print(int value) {
+	return print((long) value);
+}
+
+size_t Print::print(unsigned int value) {
+	return print((unsigned long) value);
+}
+
+size_t Print::print(long value) {
+	char text[16];
+	sprintf(text, "%ld", value);
+	return print(text);
+}
+
+size_t Print::print(unsigned long value) {
+	char text[16];
+	sprintf(text, "%lu", value);
+	return print(text);
+}
+
+size_t Print::print(double value, int digits) {
+	char text[32];
+	sprintf(text, "%.*f", digits, value);
+	return print(text);
+}
+
+size_t Print::println(const char *text) {
+	return print(text) + println();
+}
+
+size_t Print::println(int value) {
+	return print(value) + println();
+}
+
+size_t Print::println(unsigned int value) {
+	return print(value) + println();
+}
+
+size_t Print::println(long value) {
+	return print(value) + println();
+}
+
+size_t Print::println(unsigned long value) {
+	return print(value) + println();
+}
+
+size_t Print::println(double value, int digits) {
+	return print(value, digits) + println();
+}
+
+size_t Print::println() {
+	return print("\r\n");
+}
+
+uint8_t Servo::attach(int) {
+	return 0;
+}
+
+void Servo::write(int angle) {
+	if (angle == servoAngle) {
+		return;
+	}
+	if (servoAngle != -1) {
+		penCycles++;
+	}
+	servoAngle = angle;
+
+	traceEvent("servo", angle);
+	addPoint();
+}
+
+int Servo::read() {
+	return servoAngle;
+}
+
+File::File(FILE *stream) :
+		stream(stream) {
+}
+
+int File::available() {
+	long position = ftell(stream);
+	fseek(stream, 0, SEEK_END);
+	long end = ftell(stream);
+	fseek(stream, position, SEEK_SET);
+	return end - position;
+}
+
+int File::read() {
+	return fgetc(stream);
+}
+
+int File::read(void *buffer, uint16_t length) {
+	return fread(buffer, 1, length, stream);
+}
+
+size_t File::write(uint8_t c) {
+	return fputc(c, stream) == EOF ? 0 : 1;
+}
+
+size_t File::write(const uint8_t *buffer, size_t length) {
+	return fwrite(buffer, 1, length, stream);
+}
+
+bool File::seek(uint32_t position) {
+	return fseek(stream, position, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+	return ftell(stream);
+}
+
+uint32_t File::size() {
+	long position = ftell(stream);
+	fseek(stream, 0, SEEK_END);
+	long end = ftell(stream);
+	fseek(stream, position, SEEK_SET);
+	return end;
+}
+
+void File::flush() {
+	fflush(stream);
+}
+
+void File::close() {
+	if (stream) {
+		fclose(stream);
+		stream = NULL;
+	}
+}
+
+File::operator bool() {
+	return stream != NULL;
+}
+
+bool SDClass::begin(uint8_t) {
+	return true;
+}
+
+bool SDClass::exists(const char *name) {
+	FILE *stream = fopen((sdDirectory + "/" + name).c_str(), "r");
+	if (stream) {
+		fclose(stream);
+	}
+	return stream != NULL;
+}
+
+bool SDClass::remove(const char *name) {
+	return ::remove((sdDirectory + "/" + name).c_str()) == 0;
+}
+
+File SDClass::open(const char *name, int mode) {
+	std::string path = sdDirectory + "/" + name;
+
+	int fd = ::open(path.c_str(), mode, 0644);
+	if (fd < 0) {
+		return File();
+	}
+	if ((mode & O_ACCMODE) == O_RDONLY) {
+		return File(fdopen(fd, "r"));
+	}
+
+	// As with the SD library, the file is written at its end unless seek() is called, and always at its end
+	// with O_APPEND, which the file descriptor keeps.
+	FILE *stream = fdopen(fd, "r+");
+	if (stream) {
+		fseek(stream, 0, SEEK_END);
+	}
+	return File(stream);
+}
+
+int main(int argc, char **argv) {
+	bool isTraced = true;
+	bool hasPty = false;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "--no-trace")) {
+			isTraced = false;
+		} else if (!strcmp(argv[i], "--pty")) {
+			hasPty = true;
+		} else if (!strcmp(argv[i], "--power-cut") && i + 1 < argc) {
+			powerCutCycles = atof(argv[++i]) * F_CPU;
+		} else {
+			break;
+		}
+	}
+
+	if (argc - i != 2) {
+		fprintf(stderr, "Usage: %s [--no-trace] [--pty] [--power-cut <seconds>] <SD card directory> <output prefix>\n",
+				argv[0]);
+		return 1;
+	}
+
+	sdDirectory = argv[argc - 2];
+	outputPrefix = argv[argc - 1];
+
+	if (isTraced) {
+		trace = fopen((outputPrefix + ".trace").c_str(), "w");
+		if (!trace) {
+			perror(outputPrefix.c_str());
+			return 1;
+		}
+	}
+
+	if (hasPty && !openSerialPort()) {
+		return 1;
+	}
+
+	loadConfig();
+	startTime = getHostTime();
+
+	Drawall drawall;
+	drawall.start();
+
+	return 0;
+}
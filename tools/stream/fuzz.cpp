@@ -0,0 +1,179 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Fuzz the serial link frames codec (see arduino/frame.h).
+ * Build: g++ -O2 -I ../../arduino -o fuzz fuzz.cpp ../../arduino/frame.cpp
+ * Usage: fuzz [seed]
+ * Random frames are encoded in a stream, which is damaged: bytes are changed, dropped or inserted in the
+ * frames, and garbage is inserted between them. The payloads and the garbage are full of FRAME_SYNC. The
+ * decoded frames must be sent frames, in order, and no intact frame may be lost, except the ones hidden by
+ * a corrupted frame which passes the CRC check. Then pure noise is decoded, to count these false frames.
+ * Fails with a non-zero exit status.
+ */
+
+#include <frame.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/// Number of frames sent.
+#define NB_FRAMES 200000
+
+/// Number of noise bytes decoded.
+#define NB_NOISE_BYTES 10000000
+
+/// Probability to damage a frame, in percents.
+#define DAMAGE_RATE 10
+
+/// Probability to insert garbage before a frame, in percents.
+#define GARBAGE_RATE 10
+
+/// Maximum number of frames hidden by a false frame, which can not be longer than FRAME_MAX_SIZE.
+#define MAX_HIDDEN_FRAMES (FRAME_MAX_SIZE / FRAME_OVERHEAD)
+
+typedef struct {
+	uint8_t type;
+	uint8_t seq;
+	std::vector<uint8_t> payload;
+	size_t end;    ///< Position of the end of the frame in the stream.
+	bool isIntact; ///< \a true if no byte of the frame has been damaged.
+	bool isDecoded;
+} Frame;
+
+/**
+ * Get a random byte, FRAME_SYNC once in 8.
+ */
+static uint8_t randomByte() {
+	return rand() % 8 == 0 ? FRAME_SYNC : rand() & 0xFF;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [seed]\n", argv[0]);
+		return 1;
+	}
+	srand(argc == 2 ? atoi(argv[1]) : 1);
+
+	const uint8_t types[] = { FRAME_DATA, FRAME_STATE, FRAME_ACK, FRAME_NACK, FRAME_GCODE };
+	std::vector<Frame> frames(NB_FRAMES);
+	std::vector<uint8_t> stream;
+	FrameEncoder encoder;
+	long nbDamaged = 0;
+
+	for (long i = 0; i < NB_FRAMES; i++) {
+		Frame &frame = frames[i];
+		frame.type = types[rand() % sizeof(types)];
+		frame.seq = i & 0xFF;
+		frame.isIntact = true;
+		frame.isDecoded = false;
+
+		encoder.begin(frame.type);
+		int length = rand() % (FRAME_MAX_PAYLOAD + 1);
+		for (int j = 0; j < length; j++) {
+			frame.payload.push_back(randomByte());
+			encoder.add(frame.payload.back());
+		}
+		if (length == FRAME_MAX_PAYLOAD && encoder.add(0)) {
+			fprintf(stderr, "the encoder exceeds FRAME_MAX_PAYLOAD\n");
+			return 1;
+		}
+		uint8_t size = encoder.end(frame.seq);
+		std::vector<uint8_t> bytes(encoder.getFrame(), encoder.getFrame() + size);
+
+		if (rand() % 100 < DAMAGE_RATE) {
+			size_t position = rand() % size;
+			switch (rand() % 3) {
+			case 0:
+				bytes[position] ^= 1 + rand() % 255;
+				break;
+			case 1:
+				bytes.erase(bytes.begin() + position);
+				break;
+			case 2:
+				bytes.insert(bytes.begin() + position, randomByte());
+				break;
+			}
+			frame.isIntact = false;
+			nbDamaged++;
+		}
+
+		if (rand() % 100 < GARBAGE_RATE) {
+			for (int j = rand() % (2 * FRAME_MAX_SIZE); j >= 0; j--) {
+				stream.push_back(randomByte());
+			}
+		}
+		stream.insert(stream.end(), bytes.begin(), bytes.end());
+		frame.end = stream.size();
+	}
+
+	// Complete the last frame being received, if any.
+	stream.insert(stream.end(), FRAME_MAX_SIZE, 0);
+
+	FrameDecoder decoder;
+	size_t next = 0; // first frame which can be decoded
+	size_t last = 0; // first frame not received yet
+	long nbFalse = 0;
+
+	for (size_t i = 0; i < stream.size(); i++) {
+		while (last < frames.size() && frames[last].end <= i + 1) {
+			last++;
+		}
+
+		// The sequence numbers wrap, so the decoded frame is searched from the last frame received.
+		for (FrameStatus status = decoder.push(stream[i]); status == FRAME_COMPLETE;
+				status = decoder.next()) {
+			std::vector<uint8_t> payload(decoder.getPayload(), decoder.getPayload() + decoder.getLength());
+			size_t j = last;
+			while (j > next && (frames[j - 1].type != decoder.getType()
+					|| frames[j - 1].seq != decoder.getSeq() || frames[j - 1].payload != payload)) {
+				j--;
+			}
+
+			if (j == next) {
+				nbFalse++;
+			} else {
+				j--;
+				frames[j].isDecoded = true;
+				next = j + 1;
+			}
+		}
+	}
+
+	long nbDecoded = 0;
+	long nbLost = 0;
+	for (size_t i = 0; i < frames.size(); i++) {
+		nbDecoded += frames[i].isDecoded;
+		nbLost += frames[i].isIntact && !frames[i].isDecoded;
+	}
+
+	printf("frames: %d sent, %ld damaged, %ld decoded, %ld intact lost, %ld false, %lu corrupted\n",
+			NB_FRAMES, nbDamaged, nbDecoded, nbLost, nbFalse, decoder.getNbErrors());
+
+	FrameDecoder noiseDecoder;
+	long nbNoiseFrames = 0;
+	for (long i = 0; i < NB_NOISE_BYTES; i++) {
+		for (FrameStatus status = noiseDecoder.push(randomByte()); status == FRAME_COMPLETE;
+				status = noiseDecoder.next()) {
+			nbNoiseFrames++;
+		}
+	}
+	printf("noise: %d bytes, %ld false frames\n", NB_NOISE_BYTES, nbNoiseFrames);
+
+	if (nbLost > nbFalse * MAX_HIDDEN_FRAMES) {
+		fprintf(stderr, "intact frames have been lost\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,424 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Stream a GCode drawing to the plotter through the serial link, without the SD card. The plotter must be
+ * configured with startupEvent=2.
+ * Build: g++ -O2 -I ../../arduino -o stream stream.cpp ../../arduino/frame.cpp
+ * Usage: stream [--legacy [--ack]] [--errors <percent>] <serial port> <GCode file>
+ * The comments and the empty lines are not sent. M02 is sent at the end if the drawing has no M02 or M30.
+ * The messages of the plotter are printed on the standard output.
+ * By default, the plotter is built with EN_SERIAL_FRAMES: the drawing is sent in FRAME_GCODE frames (see
+ * arduino/frame.h), as long as the bytes not read by the plotter, given by its acknowledgments, fit in its
+ * serial receive buffer. After a FRAME_NACK, the frames are sent again from the one asked. With --errors,
+ * a byte of this percentage of the sent frames is changed, to check the recovery.
+ * With --legacy, for a plotter built without EN_SERIAL_FRAMES, the plotter sends DRAW_ACK once it has read
+ * and processed a line. The lines are sent as long as the unacknowledged ones fit in the serial receive
+ * buffer of the plotter (character counting), so it always has a line to read. With --ack, each line is
+ * sent once the previous one is acknowledged.
+ */
+
+#include "../../arduino/plotter.h"
+#include "../../arduino/frame.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// Size of the serial receive buffer of the plotter, in bytes.
+#define STREAM_BUFFER_SIZE 64
+
+/// Maximum length of a GCode line.
+#define LINE_MAX_LENGTH 256
+
+/// Time to wait for the plotter before giving up, in ms.
+#define STREAM_TIMEOUT 30000
+
+// Bytes sent by the plotter, see Drawall::SerialData
+#define DRAW_START_INSTRUCTIONS 0
+#define DRAW_END_INSTRUCTIONS 1
+#define DRAW_WAITING 8
+#define DRAW_DISABLE_MOTORS 10
+#define DRAW_START_MESSAGE 13
+#define DRAW_END_MESSAGE 14
+#define DRAW_STEPS 25
+#define DRAW_ACK 26
+
+/// Number of bytes following DRAW_STEPS.
+#define DRAW_STEPS_LENGTH 5
+
+/**
+ * States of the decoder of the plotter output.
+ */
+typedef enum {
+	STATE_STARTING,     ///< Text sent before the initialization data.
+	STATE_INSTRUCTIONS, ///< Initialization data, until DRAW_END_INSTRUCTIONS.
+	STATE_READY,        ///< Initialized, until DRAW_WAITING.
+	STATE_DRAWING,      ///< Single byte codes.
+	STATE_MESSAGE,      ///< Message text, until DRAW_END_MESSAGE.
+	STATE_STEPS,        ///< DRAW_STEPS report.
+	STATE_ENDED         ///< The motors are disabled.
+} State;
+
+static int port;
+static bool isLegacy = false;
+static State state = STATE_STARTING;
+static int stepsBytes;
+static long nbAcks = 0;
+
+// Frames state, with EN_SERIAL_FRAMES
+static FrameDecoder decoder;
+static size_t baseFrame = 0;      ///< First frame not acknowledged.
+static size_t nextFrame = 0;      ///< Next frame to send.
+static uint16_t nbSentBytes = 0;  ///< Bytes sent, modulo 2^16.
+static uint16_t nbReadBytes = 0;  ///< Bytes read by the plotter, modulo 2^16.
+static long nbSent = 0;
+static long nbResent = 0;
+static long nbCorrupted = 0;
+static long nbStates = 0;
+static long nbLostFrames = 0;
+static uint8_t expectedSeq = 0;   ///< Sequence number of the next plotter frame.
+
+/**
+ * Open the serial port, in raw mode at the plotter speed.
+ */
+static bool openPort(const char *path) {
+	port = open(path, O_RDWR | O_NOCTTY);
+	struct termios settings;
+	if (port < 0 || tcgetattr(port, &settings)) {
+		perror(path);
+		return false;
+	}
+
+	long bauds = isLegacy ? SERIAL_BAUDS : SERIAL_FRAMES_BAUDS;
+	speed_t speed = bauds == 1000000 ? B1000000 : bauds == 500000 ? B500000 : bauds == 230400 ? B230400
+			: bauds == 115200 ? B115200 : bauds == 57600 ? B57600 : B9600;
+
+	cfmakeraw(&settings);
+	cfsetspeed(&settings, speed);
+	if (tcsetattr(port, TCSANOW, &settings)) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Decode a byte of the legacy output of the plotter, sent as is or in FRAME_DATA frames.
+ */
+static void decode(unsigned char c) {
+	switch (state) {
+	case STATE_STARTING:
+		if (c == DRAW_START_INSTRUCTIONS) {
+			state = STATE_INSTRUCTIONS;
+		}
+		break;
+	case STATE_INSTRUCTIONS:
+		if (c == DRAW_END_INSTRUCTIONS) {
+			state = STATE_READY;
+		}
+		break;
+	case STATE_READY:
+		if (c == DRAW_WAITING) {
+			state = STATE_DRAWING;
+		}
+		break;
+	case STATE_DRAWING:
+		if (c == DRAW_ACK) {
+			nbAcks++;
+		} else if (c == DRAW_START_MESSAGE) {
+			state = STATE_MESSAGE;
+		} else if (c == DRAW_STEPS) {
+			stepsBytes = DRAW_STEPS_LENGTH;
+			state = STATE_STEPS;
+		} else if (c == DRAW_DISABLE_MOTORS) {
+			state = STATE_ENDED;
+		}
+		break;
+	case STATE_MESSAGE:
+		if (c == DRAW_END_MESSAGE) {
+			state = STATE_DRAWING;
+		} else if (c != '\r') {
+			putchar(c);
+		}
+		break;
+	case STATE_STEPS:
+		if (--stepsBytes == 0) {
+			state = STATE_DRAWING;
+		}
+		break;
+	case STATE_ENDED:
+		break;
+	}
+}
+
+/**
+ * Handle a frame sent by the plotter.
+ */
+static void receiveFrame() {
+	const uint8_t *payload = decoder.getPayload();
+	uint8_t length = decoder.getLength();
+
+	nbLostFrames += (uint8_t) (decoder.getSeq() - expectedSeq);
+	expectedSeq = decoder.getSeq() + 1;
+
+	switch (decoder.getType()) {
+	case FRAME_DATA:
+		for (uint8_t i = 0; i < length; i++) {
+			decode(payload[i]);
+		}
+		break;
+	case FRAME_STATE:
+		nbStates += length / FRAME_STATE_SIZE;
+		break;
+	case FRAME_ACK:
+	case FRAME_NACK: {
+		if (length != 3) {
+			break;
+		}
+		nbReadBytes = payload[1] | payload[2] << 8;
+
+		// The acknowledged frame is in the window: the sequence numbers can not be mixed up.
+		size_t frame = baseFrame;
+		while (frame <= nextFrame && (frame & 0xFF) != payload[0]) {
+			frame++;
+		}
+		if (frame > nextFrame) {
+			break;
+		}
+
+		if (decoder.getType() == FRAME_ACK && frame < nextFrame) {
+			baseFrame = frame + 1;
+		} else if (decoder.getType() == FRAME_NACK) {
+			baseFrame = frame;
+			nbResent += nextFrame - frame;
+			nextFrame = frame;
+		}
+		break;
+	}
+	}
+}
+
+/**
+ * Wait for the plotter output and decode it.
+ * \return \a false if the serial port has been closed.
+ */
+static bool receive() {
+	struct pollfd request = { port, POLLIN, 0 };
+	if (poll(&request, 1, STREAM_TIMEOUT) <= 0) {
+		fprintf(stderr, "The plotter does not answer.\n");
+		exit(1);
+	}
+
+	unsigned char buffer[256];
+	ssize_t length = read(port, buffer, sizeof(buffer));
+	if (length <= 0) {
+		return false;
+	}
+
+	for (ssize_t i = 0; i < length; i++) {
+		if (isLegacy) {
+			decode(buffer[i]);
+			continue;
+		}
+		for (FrameStatus status = decoder.push(buffer[i]); status == FRAME_COMPLETE;
+				status = decoder.next()) {
+			receiveFrame();
+		}
+	}
+	return true;
+}
+
+/**
+ * Wait for the plotter output, which must go on.
+ */
+static void receiveOrFail() {
+	if (!receive()) {
+		fprintf(stderr, "The serial port has been closed.\n");
+		exit(1);
+	}
+}
+
+/**
+ * Send bytes to the plotter.
+ */
+static void send(const void *bytes, size_t size) {
+	if (write(port, bytes, size) != (ssize_t) size) {
+		perror("write");
+		exit(1);
+	}
+}
+
+/**
+ * Get the GCode line to send, without the comments and the surrounding spaces.
+ * \return The line with its new line char, or an empty string if there is nothing to send.
+ */
+static std::string clean(const char *text) {
+	std::string line = text;
+
+	size_t end = line.find_first_of(";(#\r\n");
+	if (end != std::string::npos) {
+		line.erase(end);
+	}
+	line.erase(0, line.find_first_not_of(" \t"));
+	line.erase(line.find_last_not_of(" \t") + 1);
+
+	return line.empty() ? line : line + "\n";
+}
+
+/**
+ * Send the lines, each one acknowledged by DRAW_ACK.
+ */
+static void streamLines(const std::vector<std::string> &lines, bool isAckMode) {
+	std::deque<size_t> pending; // lengths of the lines not acknowledged yet
+	size_t pendingBytes = 0;
+	long nbAcknowledged = 0;
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		// Wait for enough room in the plotter buffer
+		while (!pending.empty()
+				&& (isAckMode || pendingBytes + lines[i].size() > STREAM_BUFFER_SIZE)) {
+			receiveOrFail();
+			for (; nbAcknowledged < nbAcks && !pending.empty(); nbAcknowledged++) {
+				pendingBytes -= pending.front();
+				pending.pop_front();
+			}
+		}
+
+		send(lines[i].c_str(), lines[i].size());
+		pending.push_back(lines[i].size());
+		pendingBytes += lines[i].size();
+	}
+}
+
+/**
+ * Send the drawing in frames, until they are all acknowledged.
+ */
+static void streamFrames(const std::string &text, int errorRate) {
+	size_t nbFrames = (text.size() + FRAME_MAX_PAYLOAD - 1) / FRAME_MAX_PAYLOAD;
+	FrameEncoder encoder;
+
+	while (baseFrame < nbFrames) {
+		while (nextFrame < nbFrames) {
+			encoder.begin(FRAME_GCODE);
+			for (size_t i = nextFrame * FRAME_MAX_PAYLOAD;
+					i < text.size() && encoder.add(text[i]); i++) {
+			}
+			uint8_t size = encoder.end(nextFrame & 0xFF);
+
+			if ((uint16_t) (nbSentBytes - nbReadBytes) + size > STREAM_BUFFER_SIZE) {
+				break;
+			}
+
+			uint8_t frame[FRAME_MAX_SIZE];
+			memcpy(frame, encoder.getFrame(), size);
+			if (rand() % 100 < errorRate) {
+				frame[rand() % size] ^= 1 + rand() % 255;
+				nbCorrupted++;
+			}
+
+			send(frame, size);
+			nbSentBytes += size;
+			nextFrame++;
+			nbSent++;
+		}
+		receiveOrFail();
+	}
+}
+
+int main(int argc, char **argv) {
+	bool isAckMode = false;
+	int errorRate = 0;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "--legacy")) {
+			isLegacy = true;
+		} else if (!strcmp(argv[i], "--ack")) {
+			isAckMode = true;
+		} else if (!strcmp(argv[i], "--errors") && i + 1 < argc) {
+			errorRate = atoi(argv[++i]);
+		} else {
+			break;
+		}
+	}
+
+	if (argc - i != 2 || (isAckMode && !isLegacy)) {
+		fprintf(stderr, "Usage: %s [--legacy [--ack]] [--errors <percent>] <serial port> <GCode file>\n",
+				argv[0]);
+		return 1;
+	}
+
+	FILE *input = fopen(argv[i + 1], "r");
+	if (!input) {
+		perror(argv[i + 1]);
+		return 1;
+	}
+
+	std::vector<std::string> lines;
+	std::string text;
+	bool hasEnd = false;
+	char buffer[LINE_MAX_LENGTH];
+
+	while (fgets(buffer, sizeof(buffer), input)) {
+		std::string line = clean(buffer);
+		if (!line.empty()) {
+			hasEnd = hasEnd || !line.compare(0, 3, "M02") || !line.compare(0, 3, "M30");
+			lines.push_back(line);
+			text += line;
+		}
+	}
+	fclose(input);
+
+	if (!hasEnd) {
+		lines.push_back("M02\n");
+		text += lines.back();
+	}
+
+	if (!openPort(argv[i])) {
+		return 1;
+	}
+
+	// The plotter restarts when the port is opened.
+	while (state != STATE_DRAWING) {
+		receiveOrFail();
+	}
+
+	srand(1);
+	if (isLegacy) {
+		streamLines(lines, isAckMode);
+	} else {
+		streamFrames(text, errorRate);
+	}
+
+	// The plotter ends the drawing after the last line, then may close the port.
+	while (state != STATE_ENDED && receive()) {
+	}
+	close(port);
+
+	if (isLegacy) {
+		fprintf(stderr, "%lu lines sent, %ld acknowledged\n", (unsigned long) lines.size(), nbAcks);
+	} else {
+		fprintf(stderr, "%ld frames sent (%ld again, %ld corrupted), %ld state snapshots, "
+				"%ld plotter frames lost, %lu corrupted\n", nbSent, nbResent, nbCorrupted, nbStates,
+				nbLostFrames, decoder.getNbErrors());
+	}
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+#!/bin/sh
+#
+# This file is part of DraWall.
+# DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+# General Public License as published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+# DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+# the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details. You should have received a copy of the GNU
+# General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+# © 2012–2014 Nathanaël Jourdane
+# © 2014 Victor Adam
+#
+# Fuzz the frames codec, then stream the SD card drawing to the plotter simulator through a pseudo
+# terminal and check that the plot is the same as when the drawing is read on the SD card: in frames,
+# with and without corrupted frames, then with the legacy protocol (EN_SERIAL_FRAMES disabled), with and
+# without --ack.
+# Usage: test.sh
+
+set -e
+
+TOOLS=$(dirname "$(realpath "$0")")/..
+ARDUINO=$TOOLS/../arduino
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Build the simulator with the plotter library of a directory
+build() {
+	g++ -O2 -DPROFILE_HOST -I "$TOOLS/simulator/mocks" -I "$2" -o "$WORK/$1" \
+			"$TOOLS/simulator/simulator.cpp" "$2/drawall.cpp" "$2/frame.cpp" "$2/kinematics.cpp" \
+			"$2/motors.cpp" "$2/planner.cpp" "$2/profiler.cpp" "$2/seriallink.cpp"
+}
+
+build simulator "$ARDUINO"
+cp -r "$ARDUINO" "$WORK/legacy"
+sed -i 's/^#define EN_SERIAL_FRAMES .*/#define EN_SERIAL_FRAMES 0/' "$WORK/legacy/plotter.h"
+build simulatorLegacy "$WORK/legacy"
+g++ -O2 -I "$ARDUINO" -o "$WORK/stream" "$TOOLS/stream/stream.cpp" "$ARDUINO/frame.cpp"
+g++ -O2 -I "$ARDUINO" -o "$WORK/fuzz" "$TOOLS/stream/fuzz.cpp" "$ARDUINO/frame.cpp"
+
+"$WORK/fuzz"
+
+mkdir "$WORK/card" "$WORK/streamed"
+cp "$TOOLS/../SD_files/config" "$TOOLS/../SD_files/drawing" "$WORK/card"
+"$WORK/simulator" --no-trace "$WORK/card" "$WORK/card/result" > /dev/null
+echo "card: $(grep -E '^(plotTime|starvedTime)=' "$WORK/card/result.stats" | paste -sd' ' -)"
+
+sed 's/^startupEvent=.*/startupEvent=2/' "$TOOLS/../SD_files/config" > "$WORK/streamed/config"
+
+# Stream the drawing to a simulator, with the streamer options
+run() {
+	"$WORK/$1" --no-trace --pty "$WORK/streamed" "$WORK/streamed/result" > "$WORK/output" &
+	SIMULATOR=$!
+	while ! grep -q '^serial: ' "$WORK/output"; do
+		sleep 0.1
+	done
+
+	shift
+	"$WORK/stream" "$@" "$(sed -n 's/^serial: //p' "$WORK/output")" "$TOOLS/../SD_files/drawing" \
+			> /dev/null
+	wait $SIMULATOR
+
+	cmp "$WORK/card/result.svg" "$WORK/streamed/result.svg"
+	echo "stream ${*:-(frames)}: $(grep -E '^(plotTime|starvedTime)=' "$WORK/streamed/result.stats" \
+			| paste -sd' ' -)"
+}
+
+run simulator
+run simulator --errors 5
+run simulatorLegacy --legacy
+run simulatorLegacy --legacy --ack
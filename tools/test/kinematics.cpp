@@ -0,0 +1,141 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Unit test of the belt lengths (see arduino/kinematics.h).
+ * Build, from this directory:
+ * g++ -O2 -I ../simulator/mocks -I ../../arduino -o kinematics kinematics.cpp ../../arduino/kinematics.cpp
+ * Usage: kinematics <config file>
+ * The two belt lengths are computed on each point of the sheet, every SAMPLE_STEP micrometers, with the
+ * float and the integer kinematics, and compared with the exact lengths, computed in double: they must not
+ * differ by more than one step. The time of each kinematics on the computer is printed too, by length.
+ * Fails with a non-zero exit status.
+ */
+
+// The standard headers must be included before the min() and max() macros of Arduino.h.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <kinematics.h>
+
+/// Distance between two compared points, in micrometers.
+#define SAMPLE_STEP 100
+
+/// Maximum length of a configuration line.
+#define LINE_MAX_LENGTH 64
+
+static long span, sheetPosX, sheetPosY, sheetWidth, sheetHeight;
+
+/**
+ * A kinematics to compare with the exact lengths.
+ */
+typedef struct {
+	const char *name;
+	unsigned long (*getLength)(long dx, long dy);
+} Kinematics;
+
+/**
+ * Read the plotter geometry from the configuration file, in micrometers.
+ */
+static bool readConfig(const char *fileName) {
+	FILE *config = fopen(fileName, "r");
+	if (!config) {
+		perror(fileName);
+		return false;
+	}
+
+	char line[LINE_MAX_LENGTH];
+	while (fgets(line, sizeof(line), config)) {
+		char *value = strchr(line, '=');
+		if (!value) {
+			continue;
+		}
+		*value++ = '\0';
+		long micrometers = atol(value) * 1000;
+
+		if (!strcmp(line, "span")) {
+			span = micrometers;
+		} else if (!strcmp(line, "sheetPosX")) {
+			sheetPosX = micrometers;
+		} else if (!strcmp(line, "sheetPosY")) {
+			sheetPosY = micrometers;
+		} else if (!strcmp(line, "sheetWidth")) {
+			sheetWidth = micrometers;
+		} else if (!strcmp(line, "sheetHeight")) {
+			sheetHeight = micrometers;
+		}
+	}
+	fclose(config);
+
+	return span > 0 && sheetWidth > 0 && sheetHeight > 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <config file>\n", argv[0]);
+		return 1;
+	}
+
+	if (!readConfig(argv[1])) {
+		fprintf(stderr, "%s: missing plotter geometry\n", argv[1]);
+		return 1;
+	}
+
+	double stepsByMicrometer = KIN_STEPS_BY_KM / 1000000000.0;
+	Kinematics kinematics[2] = { { "float", floatBeltLength }, { "integer", integerBeltLength } };
+	bool isFailed = false;
+
+	for (int i = 0; i < 2; i++) {
+		long maxError = 0;
+		long nbErrors = 0;
+		long nbLengths = 0;
+		double time = 0;
+
+		for (long x = 0; x <= sheetWidth; x += SAMPLE_STEP) {
+			for (long y = 0; y <= sheetHeight; y += SAMPLE_STEP) {
+				long dxs[2] = { sheetPosX + x, span - sheetPosX - x };
+				long dy = sheetPosY + sheetHeight - y;
+				long lengths[2];
+
+				timespec start, end;
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				for (int belt = 0; belt < 2; belt++) {
+					lengths[belt] = kinematics[i].getLength(dxs[belt], dy);
+				}
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				time += (end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec;
+
+				for (int belt = 0; belt < 2; belt++) {
+					long exact = floor(hypot((double) dxs[belt], (double) dy) * stepsByMicrometer);
+					long error = labs(lengths[belt] - exact);
+					if (error > maxError) {
+						maxError = error;
+					}
+					nbErrors += error > 0;
+					nbLengths++;
+				}
+			}
+		}
+
+		printf("%s belt lengths: %ld compared, %ld differ from the exact length, by %ld step at most, "
+				"%.0f ns by length\n", kinematics[i].name, nbLengths, nbErrors, maxError, time / nbLengths);
+
+		if (maxError > 1) {
+			fprintf(stderr, "the %s belt lengths differ by more than one step\n", kinematics[i].name);
+			isFailed = true;
+		}
+	}
+
+	return isFailed ? 1 : 0;
+}
@@ -0,0 +1,557 @@
+/*
+ * This file is part of DraWall.
+ * DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ * DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU
+ * General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+ * © 2012–2014 Nathanaël Jourdane
+ * © 2014 Victor Adam
+ */
+
+/**
+ * Unit test of the step generator (see arduino/motors.h).
+ * Build, from this directory:
+ * g++ -O2 -DPROFILE_HOST -I ../simulator/mocks -I ../../arduino -o motors motors.cpp ../../arduino/motors.cpp
+ * Usage: motors [<drawing file> <config file>]
+ * The timer interrupt is called in a loop, with the pins and the registers stubbed: each pin edge is
+ * recorded with the number of the interrupt which did it, which is the pulse timing of the plotter, by
+ * steps of 1 / MOTORS_FREQUENCY. The blocks are checked for:
+ * - the interval between two step events, which must follow the block rates;
+ * - the direction pins, which must change at least one interrupt before the next step;
+ * - the belt lengths, which must match the number of edges on the step pins;
+ * - the held queue, which must not start a new block.
+ * With a GCode drawing, each of its lines is also executed as one block, and compared with the former
+ * step loop of Drawall::segment(), which stepped each motor on its own float delay (see testDrawing()).
+ * Fails with a non-zero exit status.
+ */
+
+// The standard headers must be included before the min() and max() macros of Arduino.h.
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <motors.h>
+
+/// Number of simulated digital pins.
+#define TEST_NB_PINS 22
+
+/// Number of interrupts run at most for a block, before to consider the motors are stuck.
+#define TEST_MAX_TICKS 1000000
+
+/// Maximum length of a drawing or configuration line.
+#define TEST_LINE_MAX_LENGTH 128
+
+// Pins of each motor, once reversed, as in motors.cpp
+#define TEST_LEFT_STEP (PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_STEP : PIN_LEFT_MOTOR_STEP)
+#define TEST_LEFT_DIR (PLT_REVERSE_MOTORS ? PIN_RIGHT_MOTOR_DIR : PIN_LEFT_MOTOR_DIR)
+#define TEST_RIGHT_STEP (PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_STEP : PIN_RIGHT_MOTOR_STEP)
+#define TEST_RIGHT_DIR (PLT_REVERSE_MOTORS ? PIN_LEFT_MOTOR_DIR : PIN_RIGHT_MOTOR_DIR)
+
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, TIMSK2, TIFR2;
+volatile uint8_t DDRB, DDRC, DDRD, PINB, PINC, PIND;
+PortRegister PORTB(8), PORTC(14), PORTD(0);
+
+/**
+ * A level change on a pin.
+ */
+typedef struct {
+	unsigned long tick; ///< Number of the interrupt which changed the pin.
+	uint8_t pin;
+	uint8_t value;
+} Edge;
+
+static uint8_t pins[TEST_NB_PINS];
+static unsigned long ticks = 0; ///< Number of interrupts called.
+static std::vector<Edge> edges;
+static int nbFailures = 0;
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	if (pin >= TEST_NB_PINS || pins[pin] == value) {
+		return;
+	}
+	pins[pin] = value;
+
+	Edge edge = { ticks, pin, value };
+	edges.push_back(edge);
+}
+
+int digitalRead(uint8_t pin) {
+	return pin < TEST_NB_PINS ? pins[pin] : LOW;
+}
+
+PortRegister::PortRegister(uint8_t firstPin) :
+		firstPin(firstPin) {
+}
+
+PortRegister::operator uint8_t() const {
+	uint8_t value = 0;
+	for (int bit = 0; bit < 8; bit++) {
+		value |= digitalRead(firstPin + bit) << bit;
+	}
+	return value;
+}
+
+PortRegister &PortRegister::operator=(uint8_t value) {
+	for (int bit = 0; bit < 8; bit++) {
+		digitalWrite(firstPin + bit, (value >> bit) & 1);
+	}
+	return *this;
+}
+
+PortRegister &PortRegister::operator|=(uint8_t mask) {
+	return *this = *this | mask;
+}
+
+PortRegister &PortRegister::operator&=(uint8_t mask) {
+	return *this = *this & mask;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+static void fail(const char *test, const char *message) {
+	fprintf(stderr, "%s: %s\n", test, message);
+	nbFailures++;
+}
+
+/**
+ * Call the interrupt until the queue is empty.
+ * \return \a false if the motors are stuck.
+ */
+static bool runMotors() {
+	for (unsigned long i = 0; i < TEST_MAX_TICKS; i++) {
+		if (motors.isIdle()) {
+			return true;
+		}
+		ticks++;
+		TIMER2_COMPA_vect();
+	}
+	return false;
+}
+
+/**
+ * Get the interrupts which changed a pin, since an edge.
+ */
+static std::vector<unsigned long> getEdgeTicks(uint8_t pin, size_t firstEdge = 0) {
+	std::vector<unsigned long> result;
+	for (size_t i = firstEdge; i < edges.size(); i++) {
+		if (edges[i].pin == pin) {
+			result.push_back(edges[i].tick);
+		}
+	}
+	return result;
+}
+
+/**
+ * Build a block at a constant rate, without acceleration.
+ */
+static Motors::Block getBlock(unsigned long leftSteps, unsigned long rightSteps, bool pullLeft,
+		bool pullRight, unsigned long rate) {
+	Motors::Block block;
+
+	block.leftSteps = leftSteps;
+	block.rightSteps = rightSteps;
+	block.stepCount = max(leftSteps, rightSteps);
+	block.entryRate = rate;
+	block.nominalRate = rate;
+	block.exitRate = rate;
+	block.acceleration = 0;
+	block.accelerateSteps = 0;
+	block.decelerateSteps = 0;
+	block.pullLeft = pullLeft;
+	block.pullRight = pullRight;
+	return block;
+}
+
+/**
+ * At a constant rate, the step events are MOTORS_RATE_ONE / rate interrupts apart, rounded down or up.
+ */
+static void testConstantRate() {
+	const char *test = "constant rate";
+	const unsigned long rates[] = { MOTORS_RATE_ONE, MOTORS_RATE_ONE / 2, MOTORS_RATE_ONE / 5,
+			MOTORS_RATE_ONE * 2 / 7, MOTORS_RATE_ONE / 37 };
+
+	for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+		motors.start(100000, 100000);
+		size_t firstEdge = edges.size();
+		unsigned long startTick = ticks;
+		motors.push(getBlock(500, 0, false, false, rates[i]));
+		if (!runMotors()) {
+			fail(test, "the motors are stuck");
+			return;
+		}
+
+		std::vector<unsigned long> steps = getEdgeTicks(TEST_LEFT_STEP, firstEdge);
+		if (steps.size() != 500 || !getEdgeTicks(TEST_RIGHT_STEP, firstEdge).empty()) {
+			fail(test, "wrong number of steps");
+			continue;
+		}
+
+		unsigned long shortest = MOTORS_RATE_ONE / rates[i];
+		unsigned long longest = (MOTORS_RATE_ONE + rates[i] - 1) / rates[i];
+		if (steps[0] - startTick < shortest || steps[0] - startTick > longest) {
+			fail(test, "wrong delay before the first step");
+		}
+		for (size_t j = 1; j < steps.size(); j++) {
+			unsigned long interval = steps[j] - steps[j - 1];
+			if (interval < shortest || interval > longest) {
+				fail(test, "wrong interval between two steps");
+				break;
+			}
+		}
+
+		// 500 steps released from the initial length, on the step pin parity
+		if (motors.getLeftLength() != 100500 || motors.getRightLength() != 100000
+				|| pins[TEST_LEFT_STEP] != 100500 % 2) {
+			fail(test, "wrong belt lengths");
+		}
+
+		printf("%s: %lu step events by second, %.1f us between two steps\n", test,
+				(unsigned long) ((unsigned long long) rates[i] * MOTORS_FREQUENCY / MOTORS_RATE_ONE),
+				(steps.back() - steps[0]) * 1000000.0 / MOTORS_FREQUENCY / (steps.size() - 1));
+	}
+}
+
+/**
+ * The direction pins are set one interrupt before the first step in the new direction, for the setup time
+ * of the drivers, and are not written again while the direction does not change.
+ */
+static void testDirection() {
+	const char *test = "direction";
+
+	motors.start(100000, 100000);
+	size_t firstEdge = edges.size();
+	motors.push(getBlock(10, 10, true, true, MOTORS_RATE_ONE));
+	motors.push(getBlock(10, 10, true, true, MOTORS_RATE_ONE));
+	motors.push(getBlock(10, 0, false, false, MOTORS_RATE_ONE));
+	if (!runMotors()) {
+		fail(test, "the motors are stuck");
+		return;
+	}
+
+	std::vector<unsigned long> leftDir = getEdgeTicks(TEST_LEFT_DIR, firstEdge);
+	std::vector<unsigned long> rightDir = getEdgeTicks(TEST_RIGHT_DIR, firstEdge);
+	std::vector<unsigned long> leftSteps = getEdgeTicks(TEST_LEFT_STEP, firstEdge);
+	std::vector<unsigned long> rightSteps = getEdgeTicks(TEST_RIGHT_STEP, firstEdge);
+
+	// The right motor does not move in the last block: its direction is kept.
+	if (leftDir.size() != 2 || rightDir.size() != 1 || leftSteps.size() != 30
+			|| rightSteps.size() != 20) {
+		fail(test, "wrong number of edges");
+		return;
+	}
+
+	if (leftSteps[0] <= leftDir[0] || rightSteps[0] <= rightDir[0] || leftSteps[20] <= leftDir[1]
+			|| leftSteps[19] >= leftDir[1]) {
+		fail(test, "a step is done on the interrupt of a direction change");
+	}
+
+	// Pulled then released
+	if (motors.getLeftLength() != 99990 || motors.getRightLength() != 99980) {
+		fail(test, "wrong belt lengths");
+	}
+}
+
+/**
+ * With a trapezoidal profile, the interval between two steps decreases down to the nominal one, then
+ * increases up to the exit one.
+ */
+static void testAcceleration() {
+	const char *test = "acceleration";
+	Motors::Block block = getBlock(0, 2000, false, true, MOTORS_RATE_ONE / 2);
+
+	block.entryRate = MOTORS_RATE_ONE / 50;
+	block.exitRate = MOTORS_RATE_ONE / 40;
+	block.acceleration = MOTORS_RATE_ONE / 2000;
+	block.accelerateSteps = 250; // (nominal² - entry²) / (2 × acceleration)
+	block.decelerateSteps = 250;
+
+	motors.start(100000, 100000);
+	size_t firstEdge = edges.size();
+	motors.push(block);
+	if (!runMotors()) {
+		fail(test, "the motors are stuck");
+		return;
+	}
+
+	std::vector<unsigned long> steps = getEdgeTicks(TEST_RIGHT_STEP, firstEdge);
+	if (steps.size() != 2000) {
+		fail(test, "wrong number of steps");
+		return;
+	}
+
+	// The accumulator rounds each interval down or up by one interrupt.
+	for (size_t i = 2; i < steps.size(); i++) {
+		long previous = steps[i - 1] - steps[i - 2];
+		long interval = steps[i] - steps[i - 1];
+		if ((i < 250 && interval > previous + 1) || (i >= 300 && i < 1700 && interval != 2)
+				|| (i >= 1750 && interval < previous - 1)) {
+			fail(test, "the step rate does not follow the block profile");
+			break;
+		}
+	}
+
+	if (steps[1] - steps[0] > 50 || steps[1999] - steps[1998] < 30 || steps[1999] - steps[1998] > 41) {
+		fail(test, "wrong entry or exit rate");
+	}
+	if (motors.getRightLength() != 98000) {
+		fail(test, "wrong belt lengths");
+	}
+}
+
+/**
+ * While the queue is held, the blocks wait, then they are executed once it is released.
+ */
+static void testHold() {
+	const char *test = "hold";
+
+	motors.start(100000, 100000);
+	motors.hold(true);
+	size_t firstEdge = edges.size();
+	motors.push(getBlock(10, 10, false, false, MOTORS_RATE_ONE));
+	for (int i = 0; i < 1000; i++) {
+		ticks++;
+		TIMER2_COMPA_vect();
+	}
+
+	if (edges.size() != firstEdge || motors.isIdle()) {
+		fail(test, "a held block has been started");
+	}
+
+	motors.hold(false);
+	if (!runMotors() || motors.getLeftLength() != 100010) {
+		fail(test, "the released block has not been executed");
+	}
+}
+
+/**
+ * Plotter geometry of the former kinematics, in mm.
+ */
+typedef struct {
+	float span;
+	float sheetPosX;
+	float sheetPosY;
+	float sheetHeight;
+	float initPosX;
+	float initPosY;
+} Geometry;
+
+/**
+ * Read the plotter geometry from the configuration file.
+ */
+static bool readGeometry(const char *fileName, Geometry *geometry) {
+	FILE *config = fopen(fileName, "r");
+	char line[TEST_LINE_MAX_LENGTH];
+
+	if (!config) {
+		perror(fileName);
+		return false;
+	}
+
+	memset(geometry, 0, sizeof(Geometry));
+	while (fgets(line, sizeof(line), config)) {
+		char *value = strchr(line, '=');
+		if (!value) {
+			continue;
+		}
+		*value++ = '\0';
+
+		if (!strcmp(line, "span")) {
+			geometry->span = atof(value);
+		} else if (!strcmp(line, "sheetPosX")) {
+			geometry->sheetPosX = atof(value);
+		} else if (!strcmp(line, "sheetPosY")) {
+			geometry->sheetPosY = atof(value);
+		} else if (!strcmp(line, "sheetHeight")) {
+			geometry->sheetHeight = atof(value);
+		} else if (!strcmp(line, "initPosX")) {
+			geometry->initPosX = atof(value);
+		} else if (!strcmp(line, "initPosY")) {
+			geometry->initPosY = atof(value);
+		}
+	}
+	fclose(config);
+
+	return geometry->span > 0 && geometry->sheetHeight > 0;
+}
+
+/**
+ * Get the belt lengths of a position on the sheet, in float, as the former positionToLeftLength() and
+ * positionToRightLength() did.
+ */
+static void getFloatLengths(const Geometry &geometry, float posX, float posY, long *left,
+		long *right) {
+	float stepLength = (PI * PLT_PINION_DIAMETER / 1000) / (PLT_STEPS * 2 * pow(2, PLT_STEP_MODE));
+	float height = (geometry.sheetPosY + geometry.sheetHeight - posY) / stepLength;
+
+	*left = sqrt(pow((geometry.sheetPosX + posX) / stepLength, 2) + pow(height, 2));
+	*right = sqrt(pow((geometry.span - geometry.sheetPosX - posX) / stepLength, 2) + pow(height, 2));
+}
+
+/**
+ * Execute each line of a GCode drawing as one block, and compare the steps order with the former step
+ * loop. The drawing units are millimeters on the sheet, and the lengths are computed with the former float
+ * kinematics, so the two step generators get the same steps numbers.
+ * The former loop stepped the motor with the longer travel every delayBetweenSteps µs, and the other one
+ * every delayBetweenSteps × (longer steps / shorter steps) µs, computed in float. It is replayed with an
+ * exact clock: after each step of the first motor, the steps of the other one must be the same with the
+ * DDA, give or take one step. Both must end on the lengths of the line end.
+ * \return \a false if the files can not be read.
+ */
+static bool testDrawing(const char *drawingFileName, const char *configFileName) {
+	const char *test = "drawing";
+	Geometry geometry;
+	char line[TEST_LINE_MAX_LENGTH];
+	float x = 0;
+	float y = 0;
+	long left;
+	long right;
+	unsigned long nbLines = 0;
+	unsigned long nbSteps = 0;
+	unsigned long nbShifted = 0; // steps done on an other step event than with the former loop
+	long maxShift = 0;
+
+	if (!readGeometry(configFileName, &geometry)) {
+		fprintf(stderr, "%s: missing plotter geometry\n", configFileName);
+		return false;
+	}
+
+	FILE *drawing = fopen(drawingFileName, "r");
+	if (!drawing) {
+		perror(drawingFileName);
+		return false;
+	}
+
+	getFloatLengths(geometry, geometry.initPosX, geometry.initPosY, &left, &right);
+	motors.start(left, right);
+
+	while (fgets(line, sizeof(line), drawing)) {
+		if (strncmp(line, "G00 ", 4) && strncmp(line, "G01 ", 4)) {
+			continue;
+		}
+
+		// Missing coordinates keep their current value
+		char *parameter = strchr(line, 'X');
+		if (parameter) {
+			x = atof(parameter + 1);
+		}
+		parameter = strchr(line, 'Y');
+		if (parameter) {
+			y = atof(parameter + 1);
+		}
+
+		long leftTarget;
+		long rightTarget;
+		getFloatLengths(geometry, x, y, &leftTarget, &rightTarget);
+
+		long leftSteps = leftTarget - left;
+		long rightSteps = rightTarget - right;
+		nbLines++;
+
+		// As in Drawall::segment(), the lines without steps are not queued.
+		if (leftSteps == 0 && rightSteps == 0) {
+			continue;
+		}
+
+		Motors::Block block = getBlock(labs(leftSteps), labs(rightSteps), leftSteps < 0,
+				rightSteps < 0, MOTORS_RATE_ONE);
+
+		edges.clear();
+		motors.push(block);
+		if (!runMotors()) {
+			fail(test, "the motors are stuck");
+			break;
+		}
+		nbSteps += block.leftSteps + block.rightSteps;
+
+		if ((long) motors.getLeftLength() != leftTarget
+				|| (long) motors.getRightLength() != rightTarget) {
+			fail(test, "wrong belt lengths at the end of a line");
+			break;
+		}
+		left = leftTarget;
+		right = rightTarget;
+
+		if (block.leftSteps == 0 || block.rightSteps == 0) {
+			continue;
+		}
+
+		// Former delays, in units of delayBetweenSteps
+		bool isLeftLonger = block.leftSteps > block.rightSteps;
+		unsigned long longSteps = isLeftLonger ? block.leftSteps : block.rightSteps;
+		unsigned long shortSteps = isLeftLonger ? block.rightSteps : block.leftSteps;
+		float shortDelay = (float) longSteps / (float) shortSteps;
+
+		std::vector<unsigned long> longTicks = getEdgeTicks(isLeftLonger ? TEST_LEFT_STEP : TEST_RIGHT_STEP);
+		std::vector<unsigned long> shortTicks = getEdgeTicks(isLeftLonger ? TEST_RIGHT_STEP : TEST_LEFT_STEP);
+		unsigned long formerShortDone = 0;
+		unsigned long shortDone = 0;
+
+		for (unsigned long i = 1; i <= longSteps; i++) {
+			while (formerShortDone < shortSteps && (formerShortDone + 1) * shortDelay <= i) {
+				formerShortDone++;
+			}
+			while (shortDone < shortTicks.size() && shortTicks[shortDone] <= longTicks[i - 1]) {
+				shortDone++;
+			}
+
+			long shift = labs((long) shortDone - (long) formerShortDone);
+			if (shift > maxShift) {
+				maxShift = shift;
+			}
+			if (shift > 1) {
+				fail(test, "the steps order differs from the former step loop");
+				fclose(drawing);
+				return true;
+			}
+		}
+
+		// Shifted steps, by comparing the whole sequences
+		formerShortDone = 0;
+		for (unsigned long j = 0; j < shortSteps; j++) {
+			unsigned long formerEvent = ceil((j + 1) * shortDelay);
+			unsigned long event = 0;
+			while (event < longSteps && longTicks[event] < shortTicks[j]) {
+				event++;
+			}
+			if (event + 1 != formerEvent) {
+				nbShifted++;
+			}
+		}
+	}
+	fclose(drawing);
+
+	printf("%s: %lu lines, %lu steps, %lu steps shifted by one step event from the former loop, "
+			"max shift %ld step\n", test, nbLines, nbSteps, nbShifted, maxShift);
+	return true;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 1 && argc != 3) {
+		fprintf(stderr, "Usage: %s [<drawing file> <config file>]\n", argv[0]);
+		return 1;
+	}
+
+	testConstantRate();
+	testDirection();
+	testAcceleration();
+	testHold();
+	if (argc == 3 && !testDrawing(argv[1], argv[2])) {
+		return 1;
+	}
+
+	if (nbFailures > 0) {
+		fprintf(stderr, "%d failures\n", nbFailures);
+		return 1;
+	}
+	printf("step generator: ok\n");
+	return 0;
+}
@@ -0,0 +1,118 @@
+#!/bin/sh
+#
+# This file is part of DraWall.
+# DraWall is free software: you can redistribute it and/or modify it under the terms of the GNU
+# General Public License as published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+# DraWall is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+# the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details. You should have received a copy of the GNU
+# General Public License along with DraWall. If not, see <http://www.gnu.org/licenses/>.
+# © 2012–2014 Nathanaël Jourdane
+# © 2014 Victor Adam
+#
+# Build and run the host unit tests of the plotter library. The step generator is also compared with
+# the former step loop on the lines of the SD card drawing, and the simulator runs the regression drawings
+# and a power cut.
+# Usage: test.sh
+
+set -e
+
+TOOLS=$(dirname "$(realpath "$0")")/..
+ARDUINO=$TOOLS/../arduino
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+g++ -O2 -DPROFILE_HOST -I "$TOOLS/simulator/mocks" -I "$ARDUINO" -o "$WORK/motors" \
+		"$TOOLS/test/motors.cpp" "$ARDUINO/motors.cpp"
+
+g++ -O2 -I "$TOOLS/simulator/mocks" -I "$ARDUINO" -o "$WORK/kinematics" "$TOOLS/test/kinematics.cpp" \
+		"$ARDUINO/kinematics.cpp"
+
+g++ -O2 -I "$TOOLS/simulator/mocks" -I "$ARDUINO" -o "$WORK/lengthtable" "$TOOLS/lengthtable.cpp" \
+		"$ARDUINO/kinematics.cpp"
+
+g++ -O2 -DPROFILE_HOST -I "$TOOLS/simulator/mocks" -I "$ARDUINO" -o "$WORK/simulator" \
+		"$TOOLS/simulator/simulator.cpp" "$ARDUINO/drawall.cpp" "$ARDUINO/frame.cpp" \
+		"$ARDUINO/kinematics.cpp" "$ARDUINO/motors.cpp" "$ARDUINO/planner.cpp" "$ARDUINO/profiler.cpp" \
+		"$ARDUINO/seriallink.cpp"
+g++ -O2 -o "$WORK/gcode2bin" "$TOOLS/gcode2bin.cpp"
+
+"$WORK/motors" "$TOOLS/../SD_files/drawing" "$TOOLS/../SD_files/config"
+"$WORK/kinematics" "$TOOLS/../SD_files/config"
+"$WORK/lengthtable" "$TOOLS/../SD_files/config"
+
+# Simulate a GCode drawing compiled into a binary drawing, with the SD card config.
+# Usage: simulate <name> <GCode lines>
+simulate() {
+	mkdir "$WORK/$1"
+	cp "$TOOLS/../SD_files/config" "$WORK/$1/config"
+	printf "$2" > "$WORK/$1.gcode"
+	"$WORK/gcode2bin" "$WORK/$1.gcode" "$WORK/$1/drawing" > /dev/null
+	"$WORK/simulator" --no-trace "$WORK/$1" "$WORK/$1/result" > /dev/null
+}
+
+# Print the number of drawn paths of a simulated drawing.
+# Usage: drawnPaths <name>
+drawnPaths() {
+	grep -c 'stroke="black"' "$WORK/$1/result.svg" || true
+}
+
+# A drawing starting with a move to its origin: the first path must be drawn, and not taken as a short
+# pen-up move, so the simulated sheet has two drawn paths.
+simulate origin 'G00 X0 Y0\nG01 X20 Y0\nG01 X20 Y20\nG01 X0 Y20\nG00 X50 Y50\nG01 X60 Y60\n'
+PATHS=$(drawnPaths origin)
+echo "drawing starting at its origin: $PATHS drawn paths"
+if [ "$PATHS" -ne 2 ]; then
+	echo "the first path of a drawing starting at its origin is not drawn" >&2
+	exit 1
+fi
+
+# A dot, that is a pen lowered without moving, is drawn as the line after it.
+simulate dot 'G00 X10 Y10\nG01 X10 Y10 Z0\nG00 X20 Y20\nG01 X30 Y30\n'
+PATHS=$(drawnPaths dot)
+echo "drawing with a dot: $PATHS drawn paths"
+if [ "$PATHS" -ne 2 ]; then
+	echo "the dot of a binary drawing is not drawn" >&2
+	exit 1
+fi
+
+# A drawing wider than the sheet ratio, with negative coordinates, fills the sheet width, then the pen goes
+# to the end position of the config, in millimeters on the sheet.
+simulate wide 'G00 X-10 Y0\nG01 X130 Y0\nG01 X130 Y100\nG01 X-10 Y100\nG01 X-10 Y0\n'
+SHEET_WIDTH=$(sed -n 's/^sheetWidth=//p' "$WORK/wide/config")
+SHEET_HEIGHT=$(sed -n 's/^sheetHeight=//p' "$WORK/wide/config")
+END_X=$(sed -n 's/^endPosX=//p' "$WORK/wide/config")
+END_Y=$(sed -n 's/^endPosY=//p' "$WORK/wide/config")
+# SVG points: the drawn horizontal extent, then the last point of the pen, with y downwards
+BOUNDS=$(grep 'stroke="black"' "$WORK/wide/result.svg" | sed 's/.*points="//; s/".*//' | tr ' ' '\n' \
+		| awk -F, 'NF == 2 { if (n++ == 0 || $1 < min) min = $1; if ($1 > max) max = $1 } END { print min, max }')
+LAST=$(tail -n 2 "$WORK/wide/result.svg" | sed 's/.*points="//; s/".*//' | tr ' ' '\n' | grep , | tail -n 1)
+echo "wide drawing: drawn between x = $(echo "$BOUNDS" | sed 's/ / and /') mm on a $SHEET_WIDTH mm sheet, ended at $LAST"
+if ! awk -v bounds="$BOUNDS" -v last="$LAST" -v width="$SHEET_WIDTH" -v height="$SHEET_HEIGHT" \
+		-v endX="$END_X" -v endY="$END_Y" 'BEGIN {
+	split(bounds, b, " ")
+	split(last, l, ",")
+	isInside = b[1] > -1 && b[2] < width + 1 && b[2] - b[1] > width - 1
+	isAtEnd = l[1] > endX - 1 && l[1] < endX + 1 && l[2] > height - endY - 1 && l[2] < height - endY + 1
+	exit !(isInside && isAtEnd)
+}'; then
+	echo "the wide drawing does not fill the sheet width, or does not end at the end position" >&2
+	exit 1
+fi
+
+# A drawing cut by a power loss is resumed from its last checkpoint, so the resumed run draws less than
+# the full drawing: the checkpoints must overwrite their slots of the resume file, not be appended to it.
+mkdir "$WORK/resume"
+cp "$TOOLS/../SD_files/drawing" "$WORK/resume/drawing"
+sed 's/^checkpointPeriod=.*/checkpointPeriod=5/' "$TOOLS/../SD_files/config" > "$WORK/resume/config"
+"$WORK/simulator" --no-trace --power-cut 20 "$WORK/resume" "$WORK/resume/cut" > /dev/null
+"$WORK/simulator" --no-trace "$WORK/resume" "$WORK/resume/resumed" > /dev/null
+"$WORK/simulator" --no-trace "$WORK/resume" "$WORK/resume/full" > /dev/null
+RESUMED=$(sed -n 's/^plotTime=//p' "$WORK/resume/resumed.stats")
+FULL=$(sed -n 's/^plotTime=//p' "$WORK/resume/full.stats")
+echo "drawing cut after 20 s: resumed in $RESUMED s, drawn in $FULL s"
+if ! awk "BEGIN { exit !($RESUMED < $FULL) }"; then
+	echo "the drawing cut by a power loss is not resumed from its last checkpoint" >&2
+	exit 1
+fi